@@ -2,6 +2,8 @@
 
 // Computing 196 algorithm
 
+#define _POSIX_C_SOURCE 200809L // mmap, fsync
+
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
@@ -9,234 +11,1522 @@
 #include <stdnoreturn.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <time.h>
+#include <stdint.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <threads.h>
+#include <stdatomic.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_ADD // AVX2 reverse then add selected at run time
+#include <immintrin.h>
+#endif
 
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 #include <CUnit/Console.h>
 #include <CUnit/Automated.h>
 
-#define NDEBUG // test or run
+#define NDEBUG // test or run
+
+#define MIN_CAP 64 // first capacity of digit vector, doubles on growth
+#define PRINT_WIDTH 99 // numbers are right aligned in output
+#define TRIES 200 // 10000
+
+#define SCAN_BLOCK 4096 // seeds a thread takes at once in range mode
+#define MEMO_BITS 18 // log2 of iterates cached by each thread in range mode
+#define MEMO_DIG 19 // longest cached iterate, fits 64 bits
+#define MEMO_PATH 64 // iterates of a trajectory put in cache
+#define PAR_DIG (1<<20) // shorter numbers are added by one thread
+#define MAX_THREADS 256
+#define CKPT_NAME "196-algorithm.ckpt"
+#define CKPT_MAGIC "196CKPT1"
+#define OUT_BUFF (1<<20) // bytes of stdout buffer
+
+#define BENCH_DIG 1000000 // digits of benchmark number
+#define BENCH_ROUNDS 200
+
+noreturn void simple_err(const char *s)
+{
+    if( (s==NULL) || ( *s=='\0') )
+    {
+        fprintf(stderr,"Please provide a proper message for simple_err function\n");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(stderr,"%s\n",s);
+    exit(EXIT_FAILURE);
+}
+
+struct digits // growable vector of decimal digits 0-9, least significant first
+{
+    unsigned char *dig;
+    size_t len;
+    size_t cap;
+    size_t count[10]; // histogram of digits, kept by fill and reverse_then_add
+};
+
+void digits_init(struct digits *num)
+{
+    num->dig=NULL;
+    num->len=0;
+    num->cap=0;
+    memset(num->count, 0, sizeof(num->count));
+}
+
+void digits_free(struct digits *num)
+{
+    free(num->dig);
+    digits_init(num);
+}
+
+void reserve(struct digits *num, size_t cap) // amortized growth
+{
+    if(cap<=num->cap)
+        return;
+    
+    size_t new_cap = (num->cap<MIN_CAP ? MIN_CAP : num->cap);
+    while(new_cap<cap)
+        new_cap*=2;
+    
+    unsigned char *dig=realloc(num->dig, new_cap*sizeof(unsigned char));
+    if(dig==NULL)
+        simple_err("digit vector allocation failed");
+    num->dig=dig;
+    num->cap=new_cap;
+}
+
+void fill(char*str, struct digits *num)
+{
+    size_t str_len=strlen(str);
+    reserve(num,str_len+1);
+    size_t i;
+    memset(num->count, 0, sizeof(num->count));
+    for(i=0; i<str_len; i++)
+    {
+        num->dig[i] = (unsigned char)(str[str_len-1-i]-'0');
+        if(num->dig[i]<=9)
+            num->count[num->dig[i]]++;
+    }
+    num->len=str_len;
+}
+
+char* to_str(struct digits const *num) // most significant digit first
+{
+    char *str=malloc((num->len+1)*sizeof(char));
+    if(str==NULL)
+        simple_err("string allocation failed");
+    size_t i;
+    for(i=0; i<num->len; i++)
+        str[i]=(char)(num->dig[num->len-1-i]+'0');
+    str[num->len]='\0';
+    return str;
+}
+
+bool all_digits(struct digits const *num)
+{
+    size_t i;
+    for(i=0; i<num->len; i++)
+    {
+        if(num->dig[i]>9)
+            return false;
+    }
+    
+    return true;
+}
+
+void reverse(struct digits const *num, struct digits *rev)
+{
+    reserve(rev,num->len);
+    rev->len=num->len;
+    
+    size_t i;
+    for(i=0; i<num->len; i++)
+    {
+        assert(num->dig[i]<=9);
+        rev->dig[i]=num->dig[num->len-1-i];
+    }
+    memcpy(rev->count, num->count, sizeof(num->count));
+    
+    assert(all_digits(rev));
+}
+
+struct add_ops // block kernels of reverse_then_add, scalar loops do the rest, finished digits are counted
+{
+    size_t (*pair_sums)(unsigned char *dig, size_t len, unsigned *carry, size_t *count); // returns front digits done
+    size_t (*carry)(unsigned char *dig, size_t i, size_t len, unsigned *carry, size_t *count); // returns next digit
+    size_t (*pairs)(unsigned char *dig, size_t len, size_t i, size_t end); // pair sums only, returns next digit
+    size_t (*mirror)(unsigned char const *dig, size_t len); // front digits equal to back ones, stops at a differing block
+    char const *name;
+};
+
+size_t pair_sums_scalar(unsigned char *dig, size_t len, unsigned *carry, size_t *count)
+{
+    (void)dig;
+    (void)len;
+    (void)carry;
+    (void)count;
+    return 0;
+}
+
+size_t carry_scalar(unsigned char *dig, size_t i, size_t len, unsigned *carry, size_t *count)
+{
+    (void)dig;
+    (void)len;
+    (void)carry;
+    (void)count;
+    return i;
+}
+
+size_t pairs_scalar(unsigned char *dig, size_t len, size_t i, size_t end)
+{
+    (void)dig;
+    (void)len;
+    (void)end;
+    return i;
+}
+
+size_t mirror_scalar(unsigned char const *dig, size_t len)
+{
+    (void)dig;
+    (void)len;
+    return 0;
+}
+
+static struct add_ops add_ops = {pair_sums_scalar, carry_scalar, pairs_scalar, mirror_scalar, "scalar"};
+
+#ifdef SIMD_ADD
+__attribute__((target("avx2"))) static inline __m256i reverse_32(__m256i v)
+{
+    __m256i const rev=_mm256_setr_epi8(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0,
+                                       15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0);
+    v=_mm256_shuffle_epi8(v,rev);
+    return _mm256_permute2x128_si256(v,v,0x01);
+}
+
+__attribute__((target("avx2"))) static inline __m256i expand_bits(uint32_t mask) // bit k to 0xff in byte k
+{
+    __m256i const spread=_mm256_setr_epi8(0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,
+                                          2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3);
+    __m256i const bits=_mm256_set1_epi64x((long long)0x8040201008040201ULL);
+    __m256i v=_mm256_shuffle_epi8(_mm256_set1_epi32((int)mask),spread);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(v,bits),bits);
+}
+
+// sums 0-18 to digits, carry lookahead of 32 digits is one 64 bit add:
+// digit >=10 generates a carry, digit 9 propagates it
+__attribute__((target("avx2"))) static inline __m256i carry_32(__m256i v, unsigned *carry)
+{
+    __m256i const nine=_mm256_set1_epi8(9);
+    uint64_t g=(uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v,nine));
+    uint64_t m=g|(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v,nine));
+    uint64_t c=m^g^(m+g+*carry); // bit k is carry into digit k
+    
+    *carry=(unsigned)(c>>32);
+    __m256i c_in=_mm256_and_si256(expand_bits((uint32_t)c),_mm256_set1_epi8(1));
+    __m256i c_out=_mm256_and_si256(expand_bits((uint32_t)(c>>1)),_mm256_set1_epi8(10));
+    return _mm256_sub_epi8(_mm256_add_epi8(v,c_in),c_out);
+}
+
+struct count_acc // byte counters of digits 0-8, 9 is the rest
+{
+    __m256i acc[9];
+    unsigned blocks; // since flush, at most 255
+};
+
+__attribute__((target("avx2"))) static inline void count_flush(struct count_acc *ca, size_t *count)
+{
+    size_t counted=0;
+    for(int v=0; v<9; v++)
+    {
+        __m256i s=_mm256_sad_epu8(ca->acc[v],_mm256_setzero_si256());
+        size_t n=(size_t)(_mm256_extract_epi64(s,0)+_mm256_extract_epi64(s,1)
+                          +_mm256_extract_epi64(s,2)+_mm256_extract_epi64(s,3));
+        count[v]+=n;
+        counted+=n;
+        ca->acc[v]=_mm256_setzero_si256();
+    }
+    count[9]+=32*(size_t)ca->blocks-counted;
+    ca->blocks=0;
+}
+
+__attribute__((target("avx2"))) static inline void count_32(struct count_acc *ca, __m256i v, size_t *count)
+{
+    for(int k=0; k<9; k++)
+        ca->acc[k]=_mm256_sub_epi8(ca->acc[k],_mm256_cmpeq_epi8(v,_mm256_set1_epi8((char)k)));
+    if(++ca->blocks==255)
+        count_flush(ca,count);
+}
+
+__attribute__((target("avx2"))) size_t pair_sums_avx2(unsigned char *dig, size_t len, unsigned *carry, size_t *count)
+{
+    size_t i=0;
+    size_t j=len-1;
+    unsigned c=*carry; // not through memory, dig may alias it
+    struct count_acc ca={.blocks=0};
+    
+    for(int k=0; k<9; k++)
+        ca.acc[k]=_mm256_setzero_si256();
+    for(; i+63<=j && j<len; i+=32, j-=32) // front and back blocks do not overlap
+    {
+        __m256i lo=_mm256_loadu_si256((__m256i const *)(dig+i));
+        __m256i hi=_mm256_loadu_si256((__m256i const *)(dig+j-31));
+        __m256i sum=_mm256_add_epi8(lo,reverse_32(hi));
+        _mm256_storeu_si256((__m256i *)(dig+j-31),reverse_32(sum));
+        __m256i out=carry_32(sum,&c);
+        _mm256_storeu_si256((__m256i *)(dig+i),out);
+        count_32(&ca,out,count);
+    }
+    count_flush(&ca,count);
+    
+    *carry=c;
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t carry_avx2(unsigned char *dig, size_t i, size_t len, unsigned *carry, size_t *count)
+{
+    unsigned c=*carry;
+    struct count_acc ca={.blocks=0};
+    
+    for(int k=0; k<9; k++)
+        ca.acc[k]=_mm256_setzero_si256();
+    for(; i+32<=len; i+=32)
+    {
+        __m256i out=carry_32(_mm256_loadu_si256((__m256i const *)(dig+i)),&c);
+        _mm256_storeu_si256((__m256i *)(dig+i),out);
+        count_32(&ca,out,count);
+    }
+    count_flush(&ca,count);
+    
+    *carry=c;
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t pairs_avx2(unsigned char *dig, size_t len, size_t i, size_t end)
+{
+    for(; i+32<=end && i+63<=len-1-i; i+=32)
+    {
+        size_t j=len-1-i;
+        __m256i lo=_mm256_loadu_si256((__m256i const *)(dig+i));
+        __m256i hi=_mm256_loadu_si256((__m256i const *)(dig+j-31));
+        __m256i sum=_mm256_add_epi8(lo,reverse_32(hi));
+        _mm256_storeu_si256((__m256i *)(dig+j-31),reverse_32(sum));
+        _mm256_storeu_si256((__m256i *)(dig+i),sum);
+    }
+    
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t mirror_avx2(unsigned char const *dig, size_t len)
+{
+    size_t i=0;
+    size_t j=len-1;
+    
+    for(; i+63<=j && j<len; i+=32, j-=32)
+    {
+        __m256i lo=_mm256_loadu_si256((__m256i const *)(dig+i));
+        __m256i hi=_mm256_loadu_si256((__m256i const *)(dig+j-31));
+        if((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo,reverse_32(hi)))!=0xffffffffu)
+            break;
+    }
+    
+    return i;
+}
+#endif // SIMD_ADD
+
+void add_ops_init(void)
+{
+#ifdef SIMD_ADD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        add_ops.pair_sums=pair_sums_avx2;
+        add_ops.carry=carry_avx2;
+        add_ops.pairs=pairs_avx2;
+        add_ops.mirror=mirror_avx2;
+        add_ops.name="avx2";
+    }
+#endif // SIMD_ADD
+}
+
+bool is_palindrome(struct digits const *num) // outermost digits first, then blocks from both ends, no copy
+{
+    size_t i,j;
+    
+    if(num->len<2)
+        return true;
+    if(num->dig[0]!=num->dig[num->len-1]) // nearly every iterate stops here
+        return false;
+    for(i=add_ops.mirror(num->dig,num->len), j=num->len-1-i; i<j; i++, j--)
+    {
+        if(num->dig[i]!=num->dig[j])
+            return false;
+    }
+    
+    return true;
+}
+
+struct par_info
+{
+    int threads; // of reverse_then_add, 1 for none
+    size_t min_len; // digits
+};
+
+static struct par_info par = {.threads=1, .min_len=PAR_DIG};
+
+struct par_job // one chunk of a threaded reverse_then_add
+{
+    unsigned char *dig;
+    size_t len;
+    size_t lo; // pairs lo to hi-1 in first phase, digits lo to hi-1 in last phase
+    size_t hi;
+    unsigned carry; // carry into digit lo
+    size_t count[10];
+};
+
+int pairs_worker(void *arg) // d[i] and d[len-1-i] to their sum
+{
+    struct par_job *job=arg;
+    unsigned char *dig=job->dig;
+    size_t i=add_ops.pairs(dig,job->len,job->lo,job->hi);
+    
+    for(; i<job->hi; i++)
+    {
+        size_t j=job->len-1-i;
+        dig[i] = (unsigned char)(dig[i]+dig[j]);
+        dig[j] = dig[i];
+    }
+    return 0;
+}
+
+int carry_worker(void *arg) // sums to digits with known carry in
+{
+    struct par_job *job=arg;
+    unsigned char *dig=job->dig;
+    unsigned carry=job->carry;
+    unsigned sum;
+    
+    memset(job->count, 0, sizeof(job->count));
+    size_t i=add_ops.carry(dig,job->lo,job->hi,&carry,job->count);
+    for(; i<job->hi; i++)
+    {
+        sum = dig[i]+carry;
+        carry = (sum>=10);
+        dig[i] = (unsigned char)(sum-10*carry);
+        job->count[dig[i]]++;
+    }
+    job->carry=carry;
+    return 0;
+}
+
+int chunk_carry(unsigned char const *dig, size_t lo, size_t hi) // carry out of sums lo to hi-1, -1 if it is carry in
+{
+    size_t k;
+    for(k=hi; k>lo; k--) // from top, first sum which is not 9 decides
+    {
+        if(dig[k-1]>9)
+            return 1;
+        if(dig[k-1]<9)
+            return 0;
+    }
+    return -1;
+}
+
+void par_run(int threads, thrd_start_t fn, struct par_job *job)
+{
+    thrd_t thr[MAX_THREADS];
+    int t;
+    
+    for(t=1; t<threads; t++)
+    {
+        if(thrd_create(&thr[t], fn, &job[t])!=thrd_success)
+            simple_err("thread creation failed");
+    }
+    fn(&job[0]);
+    for(t=1; t<threads; t++)
+        thrd_join(thr[t], NULL);
+}
+
+void reverse_then_add_par(struct digits *num) // pair sums, then carry select over chunks
+{
+    static struct par_job job[MAX_THREADS];
+    int threads=par.threads;
+    size_t len=num->len;
+    size_t half=len/2;
+    int t;
+    
+    if(threads<1 || threads>MAX_THREADS)
+        simple_err("threads out of range");
+    reserve(num,len+1);
+    unsigned char *dig=num->dig;
+    
+    for(t=0; t<threads; t++)
+    {
+        job[t].dig=dig;
+        job[t].len=len;
+        job[t].lo=half*(size_t)t/(size_t)threads;
+        job[t].hi=half*(size_t)(t+1)/(size_t)threads;
+    }
+    par_run(threads,pairs_worker,job);
+    if(len%2==1)
+        dig[half]=(unsigned char)(2*dig[half]);
+    
+    unsigned carry=0;
+    for(t=0; t<threads; t++) // prefix of chunk carries, almost always decided by a few top sums
+    {
+        job[t].lo=len*(size_t)t/(size_t)threads;
+        job[t].hi=len*(size_t)(t+1)/(size_t)threads;
+        job[t].carry=carry;
+        int c=chunk_carry(dig,job[t].lo,job[t].hi);
+        if(c>=0)
+            carry=(unsigned)c;
+    }
+    par_run(threads,carry_worker,job);
+    
+    memset(num->count, 0, sizeof(num->count));
+    for(t=0; t<threads; t++)
+        for(int k=0; k<10; k++)
+            num->count[k]+=job[t].count[k];
+    
+    if(carry)
+    {
+        dig[len]=1;
+        num->count[1]++;
+        num->len++;
+    }
+}
+
+void reverse_then_add(struct digits *num) // in place, reversal is symmetric, digits are counted as they are finished
+{
+    assert(num->len>0);
+    
+    if(par.threads>1 && num->len>=par.min_len)
+    {
+        reverse_then_add_par(num);
+        return;
+    }
+    reserve(num,num->len+1);
+    unsigned char *dig=num->dig;
+    size_t *count=num->count;
+    size_t len=num->len;
+    unsigned carry=0;
+    unsigned sum;
+    size_t i,j;
+    
+    // digit i and digit len-1-i get the same pair sum, lower half is finished with carry,
+    // upper half keeps the pair sum until carry reaches it
+    memset(count, 0, sizeof(num->count));
+    i=add_ops.pair_sums(dig,len,&carry,count);
+    for(j=len-1-i; i<j; i++, j--)
+    {
+        sum = dig[i]+dig[j];
+        dig[j] = (unsigned char)sum;
+        sum += carry;
+        carry = (sum>=10);
+        dig[i] = (unsigned char)(sum-10*carry);
+        count[dig[i]]++;
+    }
+    
+    if(i==j) // middle digit of odd length
+    {
+        sum = 2u*dig[i]+carry;
+        carry = (sum>=10);
+        dig[i] = (unsigned char)(sum-10*carry);
+        count[dig[i]]++;
+        i++;
+    }
+    
+    i=add_ops.carry(dig,i,len,&carry,count);
+    for(; i<len; i++)
+    {
+        sum = dig[i]+carry;
+        assert(sum<=19);
+        carry = (sum>=10);
+        dig[i] = (unsigned char)(sum-10*carry);
+        count[dig[i]]++;
+    }
+    
+    if(carry)
+    {
+        dig[len]=1;
+        count[1]++;
+        num->len++;
+    }
+}
+
+double wall_time(void) // seconds, clock() would add up threads
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec+(double)ts.tv_nsec*1e-9;
+}
+
+void bench_reverse_then_add(void)
+{
+    struct digits num;
+    digits_init(&num);
+    char *str=malloc((BENCH_DIG+1)*sizeof(char));
+    if(str==NULL)
+        simple_err("bench allocation failed");
+    
+    srand(196);
+    for(int k=0; k<BENCH_DIG; k++)
+        str[k]=(char)('0'+rand()%10);
+    str[0]='1';
+    str[BENCH_DIG]='\0';
+    fill(str,&num);
+    
+    size_t digits=0;
+    double beg=wall_time();
+    for(int r=0; r<BENCH_ROUNDS; r++)
+    {
+        digits+=num.len;
+        reverse_then_add(&num);
+    }
+    double sec=wall_time()-beg;
+    printf("reverse_then_add %s: %zu digits in %.3f s, %.3g digits/s\n", add_ops.name, digits, sec, (double)digits/sec);
+    
+    free(str);
+    digits_free(&num);
+}
+
+
+void bench_is_palindrome(void) // a typical iterate and the worst case, a palindrome
+{
+    struct digits num;
+    digits_init(&num);
+    reserve(&num,BENCH_DIG);
+    num.len=BENCH_DIG;
+    srand(196);
+    for(size_t k=0; k<num.len; k++)
+        num.dig[k]=(unsigned char)(rand()%10);
+    num.dig[0]=num.dig[num.len-1]; // past the first digit pair
+    
+    for(int p=0; p<2; p++)
+    {
+        if(p==1)
+        {
+            for(size_t k=0; k<num.len/2; k++)
+                num.dig[num.len-1-k]=num.dig[k];
+        }
+        size_t digits=0;
+        int found=0;
+        double beg=wall_time();
+        for(int r=0; r<BENCH_ROUNDS; r++)
+        {
+            digits+=num.len;
+            found+=is_palindrome(&num);
+        }
+        double sec=wall_time()-beg;
+        printf("is_palindrome %s %s: %zu digits in %.3f s, %.3g digits/s\n", add_ops.name,
+               (found ? "palindrome" : "iterate"), digits, sec, (double)digits/sec);
+    }
+    
+    digits_free(&num);
+}
+
+struct packed // digits packed in 64 bit words, least significant first, unused digits are 0
+{
+    uint64_t *word;
+    uint64_t *rev; // scratch for reversed number, same capacity
+    size_t len; // digits
+    size_t cap; // words
+    unsigned radix; // 10 is packed decimal, 2 4 and 16 are plain binary
+    unsigned bits; // of a digit
+};
+
+void packed_init(struct packed *num, unsigned radix)
+{
+    num->word=NULL;
+    num->rev=NULL;
+    num->len=0;
+    num->cap=0;
+    num->radix=radix;
+    switch(radix)
+    {
+        case 2: num->bits=1; break;
+        case 4: num->bits=2; break;
+        case 10:
+        case 16: num->bits=4; break;
+        default: simple_err("packed radix is 2, 4, 10 or 16");
+    }
+}
+
+void packed_free(struct packed *num)
+{
+    free(num->word);
+    free(num->rev);
+    packed_init(num,num->radix);
+}
+
+void packed_reserve(struct packed *num, size_t digits) // amortized growth, one spare word
+{
+    size_t words=digits/(64/num->bits)+2;
+    if(words<=num->cap)
+        return;
+    
+    size_t new_cap = (num->cap<MIN_CAP/8 ? MIN_CAP/8 : num->cap);
+    while(new_cap<words)
+        new_cap*=2;
+    
+    uint64_t *word=realloc(num->word, new_cap*sizeof(uint64_t));
+    uint64_t *rev=realloc(num->rev, new_cap*sizeof(uint64_t));
+    if(word==NULL || rev==NULL)
+        simple_err("packed allocation failed");
+    memset(word+num->cap, 0, (new_cap-num->cap)*sizeof(uint64_t));
+    num->word=word;
+    num->rev=rev;
+    num->cap=new_cap;
+}
+
+unsigned digit_value(char c) // 0-9 and a-f, anything else is 99
+{
+    if(c>='0' && c<='9')
+        return (unsigned)(c-'0');
+    c=(char)tolower((unsigned char)c);
+    if(c>='a' && c<='f')
+        return (unsigned)(c-'a'+10);
+    return 99;
+}
+
+void packed_fill(char*str, struct packed *num)
+{
+    size_t str_len=strlen(str);
+    packed_reserve(num,str_len+1);
+    memset(num->word, 0, num->cap*sizeof(uint64_t));
+    size_t i;
+    for(i=0; i<str_len; i++)
+    {
+        unsigned d=digit_value(str[str_len-1-i]);
+        if(d>=num->radix)
+            simple_err("digit out of radix");
+        num->word[i*num->bits/64] |= (uint64_t)d << (i*num->bits%64);
+    }
+    num->len=str_len;
+}
+
+unsigned packed_digit(struct packed const *num, size_t i)
+{
+    return (unsigned)(num->word[i*num->bits/64] >> (i*num->bits%64)) & ((1u<<num->bits)-1);
+}
+
+void packed_to_digits(struct packed const *num, struct digits *out) // for stats and text output, counts are kept up to base 10
+{
+    reserve(out,num->len+1);
+    memset(out->count, 0, sizeof(out->count));
+    size_t i;
+    for(i=0; i<num->len; i++)
+    {
+        out->dig[i] = (unsigned char)packed_digit(num,i);
+        if(num->radix<=10)
+            out->count[out->dig[i]]++;
+    }
+    out->len=num->len;
+}
+
+char* packed_to_str(struct packed const *num) // most significant digit first
+{
+    char *str=malloc((num->len+1)*sizeof(char));
+    if(str==NULL)
+        simple_err("string allocation failed");
+    size_t i;
+    for(i=0; i<num->len; i++)
+        str[i]="0123456789abcdef"[packed_digit(num,num->len-1-i)];
+    str[num->len]='\0';
+    return str;
+}
+
+uint64_t packed_window(struct packed const *num, long lo) // bits lo to lo+63, bits below 0 are 0
+{
+    if(lo<0)
+        return num->word[0] << -lo;
+    
+    size_t q=(size_t)lo/64;
+    unsigned r=(unsigned)(lo%64);
+    if(r==0)
+        return num->word[q];
+    return (num->word[q] >> r) | (num->word[q+1] << (64-r));
+}
+
+static inline uint64_t digit_reverse(uint64_t x, unsigned bits) // bytes, then nibbles, pairs and bits
+{
+    x=__builtin_bswap64(x);
+    x=((x>>4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL)<<4);
+    if(bits<4)
+        x=((x>>2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL)<<2);
+    if(bits<2)
+        x=((x>>1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL)<<1);
+    return x;
+}
+
+uint64_t bcd_add(uint64_t a, uint64_t b, unsigned *carry) // 16 digits at once
+{
+    uint64_t t=a+0x6666666666666666ULL; // nibble carries out now happen at decimal 10
+    uint64_t u=t+b;
+    unsigned c_out=(u<t);
+    uint64_t v=u+*carry;
+    c_out|=(v<u);
+    
+    uint64_t c_in=(t^b^v) & 0x1111111111111110ULL; // carry into each nibble from below
+    uint64_t no_carry=~((c_in>>4) | ((uint64_t)c_out<<60)) & 0x1111111111111111ULL;
+    
+    *carry=c_out;
+    return v - no_carry*6; // nibbles with no carry out keep the +6 back
+}
+
+static inline uint64_t word_add(uint64_t a, uint64_t b, unsigned *carry) // base 2^bits digits add as binary
+{
+    uint64_t u=a+b;
+    unsigned c_out=(u<a);
+    uint64_t v=u+*carry;
+    c_out|=(v<u);
+    *carry=c_out;
+    return v;
+}
+
+// radix and bits are constants in every call of reverse_then_add_packed, so each base gets its own loop
+static inline void packed_step(struct packed *num, unsigned radix, unsigned bits)
+{
+    assert(num->len>0);
+    
+    packed_reserve(num,num->len+1);
+    long len=(long)(num->len*bits);
+    size_t words=(size_t)(len+63)/64;
+    unsigned carry=0;
+    size_t w;
+    
+    for(w=0; w<words; w++) // digit k of reversed is digit len-1-k, window is 0 below digit 0
+        num->rev[w]=digit_reverse(packed_window(num, len-64-(long)(w*64)), bits);
+    
+    for(w=0; w<words; w++)
+        num->word[w] = (radix==10 ? bcd_add(num->word[w], num->rev[w], &carry) : word_add(num->word[w], num->rev[w], &carry));
+    num->word[words]+=carry;
+    
+    if((num->word[(size_t)len/64] >> (len%64)) & ((1u<<bits)-1))
+        num->len++;
+}
+
+void reverse_then_add_packed(struct packed *num)
+{
+    switch(num->radix)
+    {
+        case 2: packed_step(num,2,1); break;
+        case 4: packed_step(num,4,2); break;
+        case 10: packed_step(num,10,4); break;
+        default: packed_step(num,16,4); break;
+    }
+}
+
+bool packed_is_palindrome(struct packed const *num) // outer words first, stops at first difference
+{
+    long len=(long)(num->len*num->bits);
+    size_t words=(size_t)(len+63)/64;
+    size_t w;
+    for(w=0; w<words; w++)
+    {
+        if(digit_reverse(packed_window(num, len-64-(long)(w*64)), num->bits)!=num->word[w])
+            return false;
+    }
+    return true;
+}
+
+void bench_reverse_then_add_packed(unsigned radix)
+{
+    struct packed num;
+    packed_init(&num,radix);
+    char *str=malloc((BENCH_DIG+1)*sizeof(char));
+    if(str==NULL)
+        simple_err("bench allocation failed");
+    
+    srand(196);
+    for(int k=0; k<BENCH_DIG; k++)
+        str[k]="0123456789abcdef"[rand()%radix];
+    str[0]='1';
+    str[BENCH_DIG]='\0';
+    packed_fill(str,&num);
+    
+    size_t digits=0;
+    double beg=wall_time();
+    for(int r=0; r<BENCH_ROUNDS; r++)
+    {
+        digits+=num.len;
+        reverse_then_add_packed(&num);
+    }
+    double sec=wall_time()-beg;
+    printf("reverse_then_add packed base %u: %zu digits in %.3f s, %.3g digits/s\n", radix, digits, sec, (double)digits/sec);
+    
+    free(str);
+    packed_free(&num);
+}
+
+// byte digits in bases 2 to 10, base 10 is reverse_then_add with its kernels
+static inline void radix_step(struct digits *num, unsigned radix)
+{
+    if(num->len==0)
+        return;
+    reserve(num,num->len+1);
+    unsigned char *dig=num->dig;
+    size_t *count=num->count;
+    size_t len=num->len;
+    unsigned carry=0;
+    unsigned sum;
+    size_t i,j;
+    
+    memset(count, 0, sizeof(num->count));
+    for(i=0, j=len-1; i<j; i++, j--)
+    {
+        sum = dig[i]+dig[j];
+        dig[j] = (unsigned char)sum;
+        sum += carry;
+        carry = (sum>=radix);
+        dig[i] = (unsigned char)(sum-radix*carry);
+        count[dig[i]]++;
+    }
+    
+    if(i==j)
+    {
+        sum = 2u*dig[i]+carry;
+        carry = (sum>=radix);
+        dig[i] = (unsigned char)(sum-radix*carry);
+        count[dig[i]]++;
+        i++;
+    }
+    
+    for(; i<len; i++)
+    {
+        sum = dig[i]+carry;
+        carry = (sum>=radix);
+        dig[i] = (unsigned char)(sum-radix*carry);
+        count[dig[i]]++;
+    }
+    
+    if(carry)
+    {
+        dig[len]=1;
+        count[1]++;
+        num->len++;
+    }
+}
+
+void reverse_then_add_radix(struct digits *num, unsigned radix)
+{
+    switch(radix)
+    {
+        case 2: radix_step(num,2); break;
+        case 3: radix_step(num,3); break;
+        case 4: radix_step(num,4); break;
+        case 5: radix_step(num,5); break;
+        case 6: radix_step(num,6); break;
+        case 7: radix_step(num,7); break;
+        case 8: radix_step(num,8); break;
+        case 9: radix_step(num,9); break;
+        case 10: reverse_then_add(num); break;
+        default: simple_err("byte digit radix is 2 to 10");
+    }
+}
+
+void bench_reverse_then_add_radix(unsigned radix)
+{
+    struct digits num;
+    digits_init(&num);
+    char *str=malloc((BENCH_DIG+1)*sizeof(char));
+    if(str==NULL)
+        simple_err("bench allocation failed");
+    
+    srand(196);
+    for(int k=0; k<BENCH_DIG; k++)
+        str[k]=(char)('0'+rand()%radix);
+    str[0]='1';
+    str[BENCH_DIG]='\0';
+    fill(str,&num);
+    
+    size_t digits=0;
+    double beg=wall_time();
+    for(int r=0; r<BENCH_ROUNDS; r++)
+    {
+        digits+=num.len;
+        reverse_then_add_radix(&num,radix);
+    }
+    double sec=wall_time()-beg;
+    printf("reverse_then_add bytes base %u: %zu digits in %.3f s, %.3g digits/s\n", radix, digits, sec, (double)digits/sec);
+    
+    free(str);
+    digits_free(&num);
+}
+
+void odd_digits(struct digits const *num, char *odds_dig) // odds_dig has room for 11 chars
+{
+    int k=0;
+    for(int j=0; j<=9; j++)
+    {
+        
+        if(num->count[j]%2==1)
+        {
+            odds_dig[k]=j+'0';
+            k++;
+            
+        }	
+    }
+    odds_dig[k]='\0';
+}
+
+char* odds(struct digits const *num)
+{
+    char *odds_dig=calloc(11,sizeof(char) );
+    odd_digits(num,odds_dig);
+    return odds_dig;  	
+}
+
+bool fd_ld_equal(struct digits const *num)
+{
+    unsigned char fd = num->dig[0];
+    unsigned char ld = num->dig[num->len-1];
+    if(fd==ld)
+        return true;
+    else
+        return false;
+}
+
+bool cld_crd_equal(struct digits const *num)
+{	
+    unsigned char cld; 
+    unsigned char crd;
+    size_t len=num->len;
+    
+    if(len<2) // one digit is both
+        return true;
+    crd = num->dig[len/2-1];
+    if(len%2==0)
+        cld = num->dig[len/2];
+    else
+        cld = num->dig[len/2+1];
+    
+    if(crd==cld)
+        return true;
+    else
+        return false;
+}
+
+double average(struct digits const *num)
+{
+    double av;
+    size_t sum=0;
+    for(int j=1; j<=9; j++)
+        sum += (size_t)j*num->count[j];
+    
+    av = (double)sum / (double)num->len;
+    
+    return av; 
+}
+
+void fill_number(uint64_t n, struct digits *num)
+{
+    reserve(num,21);
+    memset(num->count, 0, sizeof(num->count));
+    num->len=0;
+    do
+    {
+        num->dig[num->len]=(unsigned char)(n%10);
+        num->count[n%10]++;
+        num->len++;
+        n/=10;
+    }while(n>0);
+}
+
+uint64_t first_kin(uint64_t n) // smallest number of same length and same pair sums, so same first iterate
+{
+    unsigned char dig[20];
+    int len=0;
+    do
+    {
+        dig[len++]=(unsigned char)(n%10);
+        n/=10;
+    }while(n>0);
+    
+    for(int i=0, j=len-1; i<j; i++, j--)
+    {
+        int sum=dig[i]+dig[j];
+        int low=(j==len-1 ? 1 : 0); // leading digit is not 0
+        int hi=(sum-9>low ? sum-9 : low);
+        dig[j]=(unsigned char)hi;
+        dig[i]=(unsigned char)(sum-hi);
+    }
+    
+    uint64_t kin=0;
+    for(int k=len-1; k>=0; k--)
+        kin=kin*10+dig[k];
+    return kin;
+}
+
+struct memo_entry // outcome of a canonical iterate, key 0 is empty
+{
+    uint64_t key;
+    int left; // steps to a palindrome, or minus steps followed without one
+};
+
+struct memo // direct mapped, a new entry replaces an old one
+{
+    struct memo_entry *slot;
+    unsigned bits; // 0 for no cache
+};
+
+void memo_init(struct memo *memo, unsigned bits)
+{
+    memo->bits=bits;
+    memo->slot=NULL;
+    if(bits==0)
+        return;
+    memo->slot=calloc((size_t)1<<bits,sizeof(struct memo_entry));
+    if(memo->slot==NULL)
+        simple_err("memo allocation failed");
+}
+
+void memo_free(struct memo *memo)
+{
+    free(memo->slot);
+    memo->slot=NULL;
+}
+
+struct memo_entry *memo_slot(struct memo const *memo, uint64_t key)
+{
+    return memo->slot+((key*0x9e3779b97f4a7c15ULL)>>(64-memo->bits));
+}
+
+uint64_t digits_value(struct digits const *num) // at most MEMO_DIG digits
+{
+    uint64_t v=0;
+    for(size_t k=num->len; k>0; k--)
+        v=v*10+num->dig[k-1];
+    return v;
+}
+
+// steps to a palindrome, 0 if not reached in cap steps, a trajectory ends at an iterate whose outcome
+// is cached, its early iterates are cached by first_kin, numbers with the same next iterate share an entry
+int steps_memo(uint64_t seed, int cap, struct digits *num, struct memo *memo, bool *hit)
+{
+    uint64_t path[MEMO_PATH];
+    int path_step[MEMO_PATH];
+    int n_path=0;
+    int total=0; // step of palindrome, may be past cap
+    int horizon=cap; // no palindrome up to this step when total is 0
+    
+    *hit=false;
+    fill_number(seed,num);
+    for(int step=1; step<=cap; step++)
+    {
+        reverse_then_add(num);
+        if(is_palindrome(num))
+        {
+            total=step;
+            break;
+        }
+        if(memo->bits==0 || num->len>MEMO_DIG)
+            continue;
+        
+        uint64_t key=first_kin(digits_value(num));
+        struct memo_entry const *e=memo_slot(memo,key);
+        if(e->key==key && (e->left>0 || -e->left>=cap-step))
+        {
+            *hit=true;
+            if(e->left>0)
+                total=step+e->left;
+            else
+                horizon=step-e->left;
+            break;
+        }
+        if(n_path<MEMO_PATH)
+        {
+            path[n_path]=key;
+            path_step[n_path]=step;
+            n_path++;
+        }
+    }
+    
+    for(int k=0; k<n_path; k++)
+    {
+        struct memo_entry *e=memo_slot(memo,path[k]);
+        if(e->key==path[k] && e->left>0)
+            continue;
+        e->key=path[k];
+        e->left=(total>0 ? total-path_step[k] : path_step[k]-horizon);
+    }
+    return (total<=cap ? total : 0);
+}
+
+struct scan_result
+{
+    size_t seeds; // trajectories followed
+    size_t related; // skipped, same first iterate as a smaller seed in range
+    size_t memo; // trajectories ended at a cached iterate
+    size_t *steps; // seeds reaching a palindrome after k steps, k<=cap
+    uint64_t *cand; // Lychrel candidates, no palindrome in cap steps
+    size_t n_cand;
+    size_t cap_cand;
+};
 
-#define MAX_DIG 100 // 5000
-#define TRIES 200 // 10000
+struct scan_job
+{
+    uint64_t a;
+    uint64_t b;
+    int cap;
+    unsigned memo_bits;
+    atomic_ullong *next; // first seed of next block
+    struct scan_result res; // of this thread
+};
 
-noreturn void simple_err(const char *s)
+void result_init(struct scan_result *res, int cap)
 {
-    if( (s==NULL) || ( *s=='\0') )
-    {
-        fprintf(stderr,"Please provide a proper message for simple_err function\n");
-        exit(EXIT_FAILURE);
-    }
-    fprintf(stderr,"%s\n",s);
-    exit(EXIT_FAILURE);
+    res->seeds=0;
+    res->related=0;
+    res->memo=0;
+    res->steps=calloc((size_t)cap+1,sizeof(size_t));
+    res->cand=NULL;
+    res->n_cand=0;
+    res->cap_cand=0;
+    if(res->steps==NULL)
+        simple_err("scan result allocation failed");
 }
 
-static int len;
+void result_free(struct scan_result *res)
+{
+    free(res->steps);
+    free(res->cand);
+}
 
-void fill(char*str, char *num)
+void add_candidate(struct scan_result *res, uint64_t seed)
 {
-    for(int k=0; k<MAX_DIG; k++)
-        num[k]=' ';
-    num[MAX_DIG-1]='\0';
-    int str_len=strlen(str);
-    int i,j;
-    for(i=str_len-1,j=0; i>=0; i--,j++)
+    if(res->n_cand==res->cap_cand)
     {
-        char c=str[i];
-        num[MAX_DIG-j-2] = c ;
+        res->cap_cand=(res->cap_cand==0 ? MIN_CAP : 2*res->cap_cand);
+        uint64_t *cand=realloc(res->cand, res->cap_cand*sizeof(uint64_t));
+        if(cand==NULL)
+            simple_err("candidate allocation failed");
+        res->cand=cand;
     }
-    len=strlen(str);
+    res->cand[res->n_cand++]=seed;
 }
 
-bool all_digits(char* num)
+int scan_worker(void *arg)
 {
-    num[MAX_DIG-1]='\0';
-    int i;
-    for(i=strlen(num)-1; i>0 && num[i]!=' '; i--)
+    struct scan_job *job=arg;
+    struct digits num;
+    struct memo memo;
+    bool hit;
+    digits_init(&num);
+    memo_init(&memo,job->memo_bits);
+    
+    while(true)
     {
+        uint64_t beg=atomic_fetch_add(job->next, SCAN_BLOCK);
+        if(beg>=job->b)
+            break;
+        uint64_t end=(job->b-beg>SCAN_BLOCK ? beg+SCAN_BLOCK : job->b);
         
-        if(!isdigit(num[i]))  
+        for(uint64_t seed=beg; seed<end; seed++)
         {
-            return false;
+            uint64_t kin=first_kin(seed);
+            if(kin<seed && kin>=job->a) // followed from kin
+            {
+                job->res.related++;
+                continue;
+            }
+            
+            job->res.seeds++;
+            int steps=steps_memo(seed,job->cap,&num,&memo,&hit);
+            job->res.memo+=hit;
+            if(steps>0)
+                job->res.steps[steps]++;
+            else
+                add_candidate(&job->res,seed);
         }
     }
     
-    return true;
+    memo_free(&memo);
+    digits_free(&num);
+    return 0;
 }
 
-void reverse(char* num,char* rev)
+int cmp_u64(const void *x, const void *y)
 {
-    
-    for(int cnt=0;cnt<MAX_DIG;cnt++)
-        rev[cnt]=' ';
-    
-    rev[MAX_DIG-1]='\0';
-    num[MAX_DIG-1]='\0';
-    int i; 
-    
-    i=MAX_DIG-len-1;
-    
-    assert(isdigit(num[i]));
-    
-    int k=MAX_DIG-2;
-    int j;
-    for( j=i; j<MAX_DIG-1; j++,k--)
+    uint64_t u=*(const uint64_t *)x;
+    uint64_t v=*(const uint64_t *)y;
+    return (u>v)-(u<v);
+}
+
+void scan_range(uint64_t a, uint64_t b, int cap, int threads, unsigned memo_bits, struct scan_result *res) // seeds in [a,b)
+{
+    static struct scan_job job[MAX_THREADS];
+    thrd_t thr[MAX_THREADS];
+    atomic_ullong next=a;
+    int t;
+    
+    if(threads<1 || threads>MAX_THREADS)
+        simple_err("threads out of range");
+    if(a<1 || a>b || b>UINT64_MAX/10)
+        simple_err("seed range out of range");
+    if(memo_bits>30)
+        simple_err("memo bits out of range");
+    
+    for(t=0; t<threads; t++)
     {
-        char c=num[k];
-        assert(isdigit(c));
-        
-        rev[j]=c;
-        
+        job[t]=(struct scan_job){.a=a, .b=b, .cap=cap, .memo_bits=memo_bits, .next=&next};
+        result_init(&job[t].res,cap);
+        if(thrd_create(&thr[t], scan_worker, &job[t])!=thrd_success)
+            simple_err("thread creation failed");
     }
     
-    assert(all_digits(rev));
-    
+    result_init(res,cap);
+    for(t=0; t<threads; t++)
+    {
+        thrd_join(thr[t], NULL);
+        res->seeds+=job[t].res.seeds;
+        res->related+=job[t].res.related;
+        res->memo+=job[t].res.memo;
+        for(int k=0; k<=cap; k++)
+            res->steps[k]+=job[t].res.steps[k];
+        for(size_t k=0; k<job[t].res.n_cand; k++)
+            add_candidate(res,job[t].res.cand[k]);
+        result_free(&job[t].res);
+    }
+    qsort(res->cand, res->n_cand, sizeof(uint64_t), cmp_u64);
 }
 
-bool is_palindrome(char* num) // TODO digit by digit
+void print_scan(uint64_t a, uint64_t b, int cap, struct scan_result const *res)
 {
-    char * rev = malloc(MAX_DIG*sizeof(char));
-    memset(rev,' ', MAX_DIG*sizeof(char));
-    
-    rev[MAX_DIG-1]='\0';
-    num[MAX_DIG-1]='\0';
-    reverse(num,rev);
-    
-    int i;
-    for(i=MAX_DIG-2; i>=MAX_DIG-len-1; i--)
+    size_t pal=0;
+    for(int k=1; k<=cap; k++)
     {
-        if(num[i]!= rev[i])
-            return false;
+        pal+=res->steps[k];
+        if(res->steps[k]>0)
+            printf("steps:%d seeds:%zu\n", k, res->steps[k]);
     }
-    
-    free(rev);
-    return true;
+    for(size_t k=0; k<res->n_cand; k++)
+        printf("lychrel:%" PRIu64 "\n", res->cand[k]);
+    printf("range:[%" PRIu64 ",%" PRIu64 ") cap:%d seeds:%zu related:%zu memo:%zu palindromes:%zu lychrel:%zu\n",
+           a, b, cap, res->seeds, res->related, res->memo, pal, res->n_cand);
 }
 
-void reverse_then_add(char* num)
+struct ckpt_header // followed by len digit bytes, least significant first
 {
-    assert(strlen(num)<=MAX_DIG);
-    assert(all_digits(num));
-    
-    char * rev = malloc(MAX_DIG*sizeof(char));
-    
-    reverse(num,rev);
-    
-    int carry=0;
-    
-    int i=MAX_DIG-2;
-    int sum=0;
-    do
-    {
-        if(!isdigit(rev[i]))
-            break;
-        
-        assert(isdigit(num[i]));
-        assert(isdigit(rev[i]));
-        sum = (num[i]-'0')+(rev[i]-'0');
-        assert(sum>=0);
-        assert(sum<=18);
-        num[i] =(sum+carry)%10+'0';
-        
-        assert(isdigit(num[i]));
-        
-        if(sum+carry>= 10)
-            carry=1;
-        else
-            carry=0;
-        i--;
-    }while(rev[i]!=' ');
-    
-    assert(all_digits(num));
-    
-    if(carry)
+    char magic[8];
+    uint64_t iter; // reverse then add steps done
+    uint64_t len;
+    uint64_t hash; // FNV-1a of digits
+};
+
+uint64_t digits_hash(unsigned char const *dig, size_t len)
+{
+    uint64_t h=0xcbf29ce484222325ULL;
+    for(size_t i=0; i<len; i++)
+        h=(h^dig[i])*0x100000001b3ULL;
+    return h;
+}
+
+void save_checkpoint(char const *name, struct digits const *num, uint64_t iter) // to a temporary file, then renamed
+{
+    char tmp_name[FILENAME_MAX];
+    struct ckpt_header head={.magic=CKPT_MAGIC, .iter=iter, .len=num->len, .hash=digits_hash(num->dig,num->len)};
+    
+    if(snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", name)>=(int)sizeof(tmp_name))
+        simple_err("checkpoint name is too long");
+    FILE *file=fopen(tmp_name,"wb");
+    if(file==NULL)
+        simple_err("opening checkpoint file failed");
+    if(fwrite(&head,sizeof(head),1,file)!=1 || fwrite(num->dig,1,num->len,file)!=num->len
+       || fflush(file)!=0 || fsync(fileno(file))!=0)
+        simple_err("writing checkpoint file failed");
+    fclose(file);
+    if(rename(tmp_name,name)!=0)
+        simple_err("renaming checkpoint file failed");
+}
+
+uint64_t load_checkpoint(char const *name, struct digits *num) // returns steps done
+{
+    struct stat st;
+    struct ckpt_header head;
+    
+    int fd=open(name,O_RDONLY);
+    if(fd<0 || fstat(fd,&st)!=0)
+        simple_err("opening checkpoint file failed");
+    if((size_t)st.st_size<sizeof(head))
+        simple_err("checkpoint file is too short");
+    
+    unsigned char *map=mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    if(map==MAP_FAILED)
+        simple_err("mapping checkpoint file failed");
+    memcpy(&head,map,sizeof(head));
+    if(memcmp(head.magic,CKPT_MAGIC,sizeof(head.magic))!=0 || head.len==0
+       || head.len!=(size_t)st.st_size-sizeof(head))
+        simple_err("checkpoint file is not valid");
+    
+    unsigned char const *dig=map+sizeof(head);
+    if(digits_hash(dig,head.len)!=head.hash)
+        simple_err("checkpoint digits do not match hash");
+    reserve(num,head.len+1);
+    memcpy(num->dig,dig,head.len);
+    num->len=head.len;
+    memset(num->count, 0, sizeof(num->count));
+    for(size_t i=0; i<num->len; i++)
     {
-        assert(carry==1);
-        num[i]='1';
-        len++;
-        
-    } 
-    
-    free(rev);
-    assert(all_digits(num));
+        if(num->dig[i]>9)
+            simple_err("checkpoint digit is not valid");
+        num->count[num->dig[i]]++;
+    }
     
-    if(len > MAX_DIG-3)
-        simple_err("len limit exceeded\n");
-    return;
+    munmap(map,(size_t)st.st_size);
+    close(fd);
+    return head.iter;
 }
 
-char* odds(char*num)
+enum out_mode
 {
+    OUT_TEXT, // number and stats
+    OUT_CSV, // stats only
+    OUT_BIN // struct stats_record
+};
+
+struct stats_record // fixed width binary stats of one step
+{
+    uint64_t step;
+    uint64_t len;
+    uint64_t count[10]; // gives odds and average
+    uint8_t fd_ld;
+    uint8_t cl_cr;
+    uint8_t pad[6];
+};
+
+void print_step(FILE *out, enum out_mode mode, struct digits const *num, uint64_t step)
+{
+    char odds_arr[11];
+    bool fl = fd_ld_equal(num);
+    bool cl_cr = cld_crd_equal(num);
+    char pm=(fl == true ? '+' : '-');
+    char pm2=(cl_cr==true ? '+' : '-');
     
-    int count[10]={0};
-    
-    char *odds_dig=calloc(11,sizeof(char) );
-    size_t i;
-    for(i=MAX_DIG-2;isdigit(num[i]);i--)
+    if(mode==OUT_BIN)
     {
-        count[num[i]-'0']++;
-    }	
+        struct stats_record rec={.step=step, .len=num->len, .fd_ld=fl, .cl_cr=cl_cr};
+        for(int k=0; k<10; k++)
+            rec.count[k]=num->count[k];
+        if(fwrite(&rec,sizeof(rec),1,out)!=1)
+            simple_err("writing stats record failed");
+        return;
+    }
     
-    int k=0;
-    for(int j=0; j<=9; j++)
+    odd_digits(num,odds_arr);
+    if(mode==OUT_CSV)
     {
-        
-        if(count[j]%2==1)
-        {
-            odds_dig[k]=j+'0';
-            k++;
-            
-        }	
+        fprintf(out,"%" PRIu64 ",%zu,%c,%c,%.2f,%s\n", step, num->len, pm, pm2, average(num), odds_arr);
+        return;
     }
     
-    assert(all_digits(odds_dig));
-    return odds_dig;  	
+    char *num_str=to_str(num);
+    fprintf(out,"num:%*s fd_ld:%c cl_cr:%c av:%.2f odds:%s\n",PRINT_WIDTH,num_str, pm,pm2, average(num), odds_arr);
+    free(num_str);
 }
 
-bool fd_ld_equal(char* num)
+bool is_packed_radix(unsigned radix) // bases with a word engine, 10 keeps its byte kernels
 {
-    char fd = num[MAX_DIG-2];
-    char ld= num[MAX_DIG - len-1];
-    if(fd==ld)
-        return true;
-    else
-        return false;
+    return radix==2 || radix==4 || radix==16;
 }
 
-bool cld_crd_equal(char * num)
-{	
-    char cld; 
-    char crd;
+// steps of seed in base radix until a palindrome, -1 if none in cap steps, out gets digits every sample steps
+int radix_steps(char *seed, unsigned radix, int cap, int sample, FILE *out)
+{
+    struct packed pnum;
+    struct digits num;
+    bool packed=is_packed_radix(radix);
+    int steps=-1;
     
-    if(len%2==0)
+    digits_init(&num);
+    if(packed)
+    {
+        packed_init(&pnum,radix);
+        packed_fill(seed,&pnum);
+    }
+    else
     {
-        crd = num[MAX_DIG - len/2-1];
-        cld = num[MAX_DIG - len/2 -2];
-    }else{
-        crd = num[MAX_DIG - len/2-1];
-        cld = num[MAX_DIG - len/2 -3];
+        fill(seed,&num);
+        for(size_t k=0; k<num.len; k++)
+        {
+            if(num.dig[k]>=radix)
+                simple_err("digit out of radix");
+        }
     }
     
-    assert(isdigit(crd));
-    assert(isdigit(cld));
+    for(int i=1; i<=cap; i++)
+    {
+        if(packed)
+            reverse_then_add_packed(&pnum);
+        else
+            reverse_then_add_radix(&num,radix);
+        
+        if(out!=NULL && i%sample==0)
+            fprintf(out,"step:%d digits:%zu\n", i, (packed ? pnum.len : num.len));
+        if(packed ? packed_is_palindrome(&pnum) : is_palindrome(&num))
+        {
+            steps=i;
+            break;
+        }
+    }
     
-    if(crd==cld)
-        return true;
-    else
-        return false;
+    if(packed)
+        packed_free(&pnum);
+    digits_free(&num);
+    return steps;
 }
 
-double average(char* num)
+enum engine
 {
-    double av;
-    int sum=0;
-    int i;
-    for(i=MAX_DIG-len-1; i<=MAX_DIG-2; i++)
-        sum += (num[i]-'0');
+    ENGINE_DIGITS, // a byte each digit, AVX2 and threads when available
+    ENGINE_BCD // struct packed base 10, 16 digits a word
+};
+
+// steps i to cap-1 of the 196 run, stats every sample steps, a checkpoint to ckpt every steps, returns steps done
+uint64_t run_steps(struct digits *num, uint64_t i, uint64_t cap, enum engine engine, enum out_mode mode, int sample, int every, char const *ckpt, FILE *out)
+{
+    struct packed pnum;
+    bool bcd=(engine==ENGINE_BCD);
     
-    av = (double)sum / (double)len;
+    if(bcd) // num is only updated for output
+    {
+        char *str=to_str(num);
+        packed_init(&pnum,10);
+        packed_fill(str,&pnum);
+        free(str);
+    }
     
-    return av; 
+    while(i<cap) // a checkpoint at cap or beyond is already finished
+    {
+        if(i%(uint64_t)sample==0)
+        {
+            if(bcd)
+                packed_to_digits(&pnum,num);
+            print_step(out,mode,num,i);
+        }
+        if(bcd)
+            reverse_then_add_packed(&pnum);
+        else
+            reverse_then_add(num);
+        i++;
+        if(every>0 && (i%(uint64_t)every==0 || i==cap))
+        {
+            if(bcd)
+                packed_to_digits(&pnum,num);
+            save_checkpoint(ckpt,num,i);
+        }
+    }
+    
+    if(bcd)
+    {
+        packed_to_digits(&pnum,num);
+        packed_free(&pnum);
+    }
+    return i;
 }
 
 // test prototypes
@@ -252,13 +1542,54 @@ void test_odds(void);
 void test_fd_ld_equal(void);
 void test_cld_crd_equal(void);
 void test_average(void);
+void test_long_number(void);
+void test_reverse_then_add_in_place(void);
+void test_add_ops(void);
+void test_bcd(void);
+void test_count(void);
+void test_first_kin(void);
+void test_scan_range(void);
+void test_par(void);
+void test_checkpoint(void);
+void test_print_step(void);
+void test_radix(void);
+void test_run_steps(void);
 
 //////////////////////
 
-int main(void) // first/last digit equality, center_left/center_right digit eq, average of digits , oddly occurred digits
+int main(int argc, char *argv[]) // first/last digit equality, center_left/center_right digit eq, average of digits , oddly occurred digits
 {
 
+    add_ops_init();
+
+#ifdef BENCH
+    struct add_ops best=add_ops;
+    add_ops=(struct add_ops){pair_sums_scalar, carry_scalar, pairs_scalar, mirror_scalar, "scalar"};
+    bench_reverse_then_add();
+    bench_is_palindrome();
+    add_ops=best;
+    if(add_ops.pair_sums!=pair_sums_scalar)
+    {
+        bench_reverse_then_add();
+        bench_is_palindrome();
+    }
+    par.threads=4;
+    par.min_len=0;
+    printf("4 threads, ");
+    bench_reverse_then_add();
+    par.threads=1;
+    unsigned byte_radix[]={2, 3, 8};
+    for(int k=0; k<3; k++)
+        bench_reverse_then_add_radix(byte_radix[k]);
+    unsigned word_radix[]={2, 4, 10, 16};
+    for(int k=0; k<4; k++)
+        bench_reverse_then_add_packed(word_radix[k]);
+    return 0;
+#endif // BENCH
+
 #ifndef NDEBUG
+    (void)argc;
+    (void)argv;
     int ir;
 
     ir = CU_initialize_registry();
@@ -312,6 +1643,42 @@ int main(void) // first/last digit equality, center_left/center_right digit eq,
     CU_pTest test10 = CU_add_test(suite1, "test_average", test_average);
     if(test10 == NULL)
         simple_err("test10 creation failed.");
+    CU_pTest test11 = CU_add_test(suite1, "test_long_number", test_long_number);
+    if(test11 == NULL)
+        simple_err("test11 creation failed.");
+    CU_pTest test12 = CU_add_test(suite1, "test_reverse_then_add_in_place", test_reverse_then_add_in_place);
+    if(test12 == NULL)
+        simple_err("test12 creation failed.");
+    CU_pTest test13 = CU_add_test(suite1, "test_add_ops", test_add_ops);
+    if(test13 == NULL)
+        simple_err("test13 creation failed.");
+    CU_pTest test14 = CU_add_test(suite1, "test_bcd", test_bcd);
+    if(test14 == NULL)
+        simple_err("test14 creation failed.");
+    CU_pTest test15 = CU_add_test(suite1, "test_count", test_count);
+    if(test15 == NULL)
+        simple_err("test15 creation failed.");
+    CU_pTest test16 = CU_add_test(suite1, "test_first_kin", test_first_kin);
+    if(test16 == NULL)
+        simple_err("test16 creation failed.");
+    CU_pTest test17 = CU_add_test(suite1, "test_scan_range", test_scan_range);
+    if(test17 == NULL)
+        simple_err("test17 creation failed.");
+    CU_pTest test18 = CU_add_test(suite1, "test_par", test_par);
+    if(test18 == NULL)
+        simple_err("test18 creation failed.");
+    CU_pTest test19 = CU_add_test(suite1, "test_checkpoint", test_checkpoint);
+    if(test19 == NULL)
+        simple_err("test19 creation failed.");
+    CU_pTest test20 = CU_add_test(suite1, "test_print_step", test_print_step);
+    if(test20 == NULL)
+        simple_err("test20 creation failed.");
+    CU_pTest test21 = CU_add_test(suite1, "test_radix", test_radix);
+    if(test21 == NULL)
+        simple_err("test21 creation failed.");
+    CU_pTest test22 = CU_add_test(suite1, "test_run_steps", test_run_steps);
+    if(test22 == NULL)
+        simple_err("test22 creation failed.");
     
     
     CU_basic_set_mode(CU_BRM_VERBOSE); 
@@ -322,31 +1689,106 @@ int main(void) // first/last digit equality, center_left/center_right digit eq,
     CU_cleanup_registry();
 
 #else
-    printf("196 algorithm:\n");
-    
-    char *num=malloc(MAX_DIG*sizeof(char));
-    fill("196",num);
-    char* odds_arr;
-    int i=0;
-    bool fl,cl_cr;
-    char pm,pm2;
-    double av;
+    uint64_t range_a=0;
+    uint64_t range_b=0;
+    uint64_t cap=TRIES;
+    int threads=1;
+    char *seed="196";
+    char *resume=NULL;
+    int every=0; // steps between checkpoints, 0 for none
+    enum out_mode mode=OUT_TEXT;
+    int sample=1; // steps between output lines
+    unsigned radix=10;
+    int memo_bits=MEMO_BITS;
+    enum engine engine=ENGINE_DIGITS;
+    
+    for(int k=1; k<argc; k++)
+    {
+        if(strncmp(argv[k],"-range=",7)==0)
+        {
+            if(sscanf(argv[k]+7, "%" SCNu64 ",%" SCNu64, &range_a, &range_b)!=2)
+                simple_err("Enter -range=A,B to scan seeds A to B-1.");
+        }
+        else if(strncmp(argv[k],"-cap=",5)==0)
+            cap=strtoull(argv[k]+5,NULL,10);
+        else if(strncmp(argv[k],"-threads=",9)==0)
+            threads=atoi(argv[k]+9);
+        else if(strncmp(argv[k],"-seed=",6)==0)
+            seed=argv[k]+6;
+        else if(strncmp(argv[k],"-ckpt=",6)==0)
+            every=atoi(argv[k]+6);
+        else if(strncmp(argv[k],"-resume=",8)==0)
+            resume=argv[k]+8;
+        else if(strcmp(argv[k],"-out=text")==0)
+            mode=OUT_TEXT;
+        else if(strcmp(argv[k],"-out=csv")==0)
+            mode=OUT_CSV;
+        else if(strcmp(argv[k],"-out=bin")==0)
+            mode=OUT_BIN;
+        else if(strncmp(argv[k],"-every=",7)==0)
+            sample=atoi(argv[k]+7);
+        else if(strncmp(argv[k],"-radix=",7)==0)
+            radix=(unsigned)atoi(argv[k]+7);
+        else if(strncmp(argv[k],"-memo=",6)==0)
+            memo_bits=atoi(argv[k]+6);
+        else if(strcmp(argv[k],"-engine=digits")==0)
+            engine=ENGINE_DIGITS;
+        else if(strcmp(argv[k],"-engine=bcd")==0)
+            engine=ENGINE_BCD;
+        else
+            simple_err("Arguments are -range=A,B -cap=STEPS -threads=NUM -memo=BITS -seed=NUM -ckpt=STEPS -resume=FILE -out=text|csv|bin -every=STEPS -radix=BASE -engine=digits|bcd");
+    }
+    if(cap<1)
+        simple_err("cap is at least 1");
+    if((radix!=10 || range_b>0) && cap>INT_MAX)
+        simple_err("cap is at most INT_MAX with -radix and -range");
+    if(sample<1)
+        simple_err("every is at least 1");
+    if(memo_bits<0)
+        simple_err("memo is at least 0");
+    if(setvbuf(stdout,NULL,_IOFBF,OUT_BUFF)!=0)
+        simple_err("stdout buffer failed");
+    
+    if(radix!=10)
+    {
+        if(radix<2 || (radix>10 && !is_packed_radix(radix)))
+            simple_err("radix is 2 to 10 or 16");
+        printf("base %u reverse then add of %s:\n", radix, seed);
+        int steps=radix_steps(seed,radix,(int)cap,sample,stdout);
+        if(steps<0)
+            printf("No palindrome in %" PRIu64 " steps.\n", cap);
+        else
+            printf("Palindrome after %d steps.\n", steps);
+        return 0;
+    }
     
-    do{
-        
-        odds_arr=odds(num);
-        fl = fd_ld_equal(num);
-        cl_cr = cld_crd_equal(num);
-        pm=(fl == true ? '+' : '-');
-        pm2=(cl_cr==true ? '+' : '-');
-        av = average(num);
-        printf("num:%s fd_ld:%c cl_cr:%c av:%.2f odds:%s\n",num, pm,pm2, av, odds_arr);
-        reverse_then_add(num);
-        free(odds_arr);
-        i++;
-    }while(i<TRIES);
-    free(num);
-    printf("Finished.\n");
+    if(range_b>0)
+    {
+        struct scan_result res;
+        scan_range(range_a,range_b,(int)cap,threads,(unsigned)memo_bits,&res);
+        print_scan(range_a,range_b,(int)cap,&res);
+        result_free(&res);
+        return 0;
+    }
+    
+    par.threads=threads;
+    if(mode==OUT_TEXT)
+        printf("196 algorithm:\n");
+    else if(mode==OUT_CSV)
+        printf("step,digits,fd_ld,cl_cr,av,odds\n");
+    
+    struct digits num;
+    digits_init(&num);
+    fill(seed,&num);
+    if(num.len==0 || !all_digits(&num) || (num.len>1 && num.dig[num.len-1]==0))
+        simple_err("seed is not a number");
+    uint64_t i=0;
+    if(resume!=NULL)
+        i=load_checkpoint(resume,&num);
+    run_steps(&num,i,cap,engine,mode,sample,every,CKPT_NAME,stdout);
+    digits_free(&num);
+    if(mode==OUT_TEXT)
+        printf("Finished.\n");
     
 #endif // NDEBUG
     return 0;
@@ -357,135 +1799,155 @@ int main(void) // first/last digit equality, center_left/center_right digit eq,
 //////////////////////////
 void test_fill(void)
 {
-    char * num = malloc(MAX_DIG*sizeof(char));
-    memset(num,' ', MAX_DIG*sizeof(char));
-    fill("123",num);
-    CU_ASSERT(num[MAX_DIG-1]=='\0');
-    CU_ASSERT(num[MAX_DIG-2]=='3');
-    CU_ASSERT(num[MAX_DIG-3]=='2');
-    CU_ASSERT(num[MAX_DIG-4]=='1');
-    CU_ASSERT(num[MAX_DIG-5]==' ');
-    free(num);
-    
-    char * num2 = malloc(MAX_DIG*sizeof(char));
-    memset(num2,' ', MAX_DIG*sizeof(char));
-    fill("89",num2);
-    CU_ASSERT(num2[MAX_DIG-1]=='\0');
-    CU_ASSERT(num2[MAX_DIG-2]=='9');
-    CU_ASSERT(num2[MAX_DIG-3]=='8');
-    CU_ASSERT(num2[MAX_DIG-4]==' ');
-    
-    free(num2);
+    struct digits num;
+    digits_init(&num);
+    fill("123",&num);
+    CU_ASSERT(num.len==3);
+    CU_ASSERT(num.dig[0]==3);
+    CU_ASSERT(num.dig[1]==2);
+    CU_ASSERT(num.dig[2]==1);
+    
+    fill("89",&num);
+    CU_ASSERT(num.len==2);
+    CU_ASSERT(num.dig[0]==9);
+    CU_ASSERT(num.dig[1]==8);
+    
+    char *str=to_str(&num);
+    CU_ASSERT_STRING_EQUAL(str,"89");
+    free(str);
+    digits_free(&num);
 }
 
 void test_all_digits(void)
 {
+    struct digits num;
+    digits_init(&num);
+    fill("165944604392018",&num);
+    CU_ASSERT(all_digits(&num));
     
-    char * num = malloc(MAX_DIG*sizeof(char));
-    memset(num,' ', MAX_DIG*sizeof(char));
-    fill("165944604392018",num);
-    CU_ASSERT(all_digits(num));
+    fill("12a3",&num);
     
-    fill("12a3",num);
+    CU_ASSERT_FALSE(all_digits(&num));
     
-    CU_ASSERT_FALSE(all_digits(num));
+    struct digits num2;
+    digits_init(&num2);
+    fill("196",&num);
+    CU_ASSERT(all_digits(&num2));
     
-    char * num2 = malloc(MAX_DIG*sizeof(char));
-    memset(num2,' ', MAX_DIG*sizeof(char));
-    fill("196",num);
-    CU_ASSERT(all_digits(num2));
-    
-    free(num);
-    free(num2);
+    digits_free(&num);
+    digits_free(&num2);
 }
 
 void test_reverse(void)
 {
-    
-    char * num = malloc(MAX_DIG*sizeof(char));
-    memset(num,' ', MAX_DIG*sizeof(char));
-    
-    char * rev = malloc(MAX_DIG*sizeof(char));
-    memset(rev,' ', MAX_DIG*sizeof(char));
-    
-    fill("12321",num);
-    
-    reverse(num,rev);
-    
-    CU_ASSERT_STRING_EQUAL(num,rev);
-    
-    fill("123",num);
-    reverse(num,rev);
-    
-    fill("321",num);
-    CU_ASSERT_STRING_EQUAL(rev,num);
-    
-    fill("1234567890",num);
-    reverse(num,rev);
-    fill("0987654321",num);
-    CU_ASSERT_STRING_EQUAL(rev,num);
-    
-    free(num);
-    free(rev);
+    struct digits num;
+    struct digits rev;
+    digits_init(&num);
+    digits_init(&rev);
+    char *str;
+    
+    fill("12321",&num);
+    reverse(&num,&rev);
+    str=to_str(&rev);
+    CU_ASSERT_STRING_EQUAL(str,"12321");
+    free(str);
+    
+    fill("123",&num);
+    reverse(&num,&rev);
+    str=to_str(&rev);
+    CU_ASSERT_STRING_EQUAL(str,"321");
+    free(str);
+    
+    fill("1234567890",&num);
+    reverse(&num,&rev);
+    str=to_str(&rev);
+    CU_ASSERT_STRING_EQUAL(str,"0987654321");
+    free(str);
+    
+    digits_free(&num);
+    digits_free(&rev);
 }
 
 void test_is_palindrome(void)
 {
+    struct digits num;
+    digits_init(&num);
+    
+    fill("12321",&num);
+    CU_ASSERT_EQUAL(is_palindrome(&num),true);
+    
+    fill("196",&num);
+    CU_ASSERT_EQUAL(is_palindrome(&num),false);
+    fill("12",&num);
+    CU_ASSERT_EQUAL(is_palindrome(&num),false);
+    fill("11",&num);
+    CU_ASSERT_EQUAL(is_palindrome(&num),true);
+    fill("99",&num);
+    CU_ASSERT_EQUAL(is_palindrome(&num),true);
+    fill("888",&num);
+    CU_ASSERT_EQUAL(is_palindrome(&num),true);
+    fill("887",&num);
+    CU_ASSERT_EQUAL(is_palindrome(&num),false);
+    fill("550",&num);
+    CU_ASSERT_EQUAL(is_palindrome(&num),false);
+    
+    struct add_ops best=add_ops;
+    struct add_ops scalar={pair_sums_scalar, carry_scalar, pairs_scalar, mirror_scalar, "scalar"};
+    size_t lens[]={63, 64, 65, 127, 128, 1001};
+    reserve(&num,1001);
+    for(int t=0; t<6; t++)
+    {
+        size_t len=lens[t];
+        num.len=len;
+        for(size_t k=0; k<len; k++)
+            num.dig[k]=num.dig[len-1-k]=(unsigned char)((k*k+3)%10);
+        for(size_t k=0; k<=len/2; k++) // a changed digit in every block and at the middle
+        {
+            add_ops=best;
+            CU_ASSERT(is_palindrome(&num));
+            num.dig[len-1-k]=(unsigned char)((num.dig[len-1-k]+1)%10);
+            CU_ASSERT_EQUAL(is_palindrome(&num),(k==len-1-k));
+            add_ops=scalar;
+            CU_ASSERT_EQUAL(is_palindrome(&num),(k==len-1-k));
+            num.dig[len-1-k]=(unsigned char)((num.dig[len-1-k]+9)%10);
+        }
+    }
+    add_ops=best;
     
-    char * num = malloc(MAX_DIG*sizeof(char));
-    
-    fill("12321",num);
-    CU_ASSERT_EQUAL(is_palindrome(num),true);
-    
-    fill("196",num);
-    CU_ASSERT_EQUAL(is_palindrome(num),false);
-    fill("12",num);
-    CU_ASSERT_EQUAL(is_palindrome(num),false);
-    fill("11",num);
-    CU_ASSERT_EQUAL(is_palindrome(num),true);
-    fill("99",num);
-    CU_ASSERT_EQUAL(is_palindrome(num),true);
-    fill("888",num);
-    CU_ASSERT_EQUAL(is_palindrome(num),true);
-    fill("887",num);
-    CU_ASSERT_EQUAL(is_palindrome(num),false);
-    fill("550",num);
-    CU_ASSERT_EQUAL(is_palindrome(num),false);
-    
-    free(num);
+    digits_free(&num);
 }
 
 void test_reverse_then_add(void)
 {
-    
-    char * num = malloc(MAX_DIG*sizeof(char));
-    memset(num,' ', MAX_DIG*sizeof(char));
-    
-    char * rta = malloc(MAX_DIG*sizeof(char));
-    memset(rta,' ', MAX_DIG*sizeof(char));
-    
-    fill("10",num);
-    reverse_then_add(num);
-    fill("11",rta);
-    CU_ASSERT_STRING_EQUAL(num,rta);
-    
-    fill("196",num);
-    reverse_then_add(num);
-    fill("887",rta);
-    CU_ASSERT_STRING_EQUAL(num,rta);
-    
-    fill("887",num);
-    reverse_then_add(num);
-    fill("1675",rta);
-    CU_ASSERT_STRING_EQUAL(num,rta);
-    
-    fill("1675",num);
-    reverse_then_add(num);
-    fill("7436",rta);
-    CU_ASSERT_STRING_EQUAL(num,rta);
-    
-    free(num);
-    free(rta);
+    struct digits num;
+    digits_init(&num);
+    char *str;
+    
+    fill("10",&num);
+    reverse_then_add(&num);
+    str=to_str(&num);
+    CU_ASSERT_STRING_EQUAL(str,"11");
+    free(str);
+    
+    fill("196",&num);
+    reverse_then_add(&num);
+    str=to_str(&num);
+    CU_ASSERT_STRING_EQUAL(str,"887");
+    free(str);
+    
+    fill("887",&num);
+    reverse_then_add(&num);
+    str=to_str(&num);
+    CU_ASSERT_STRING_EQUAL(str,"1675");
+    free(str);
+    
+    fill("1675",&num);
+    reverse_then_add(&num);
+    str=to_str(&num);
+    CU_ASSERT_STRING_EQUAL(str,"7436");
+    free(str);
+    
+    digits_free(&num);
 }
 
 void test_reverse_then_add2(void)
@@ -496,122 +1958,588 @@ void test_reverse_then_add2(void)
     int i;
     for(i=0; i<seq_len-1; i++)
     {
+        struct digits nums;
+        digits_init(&nums);
         
-        char * nums = malloc(MAX_DIG*sizeof(char));	
-        char * next = malloc(MAX_DIG*sizeof(char));
+        fill(sequence[i],&nums);
+        reverse_then_add(&nums);
+        char *str=to_str(&nums);
+        CU_ASSERT_STRING_EQUAL(str,sequence[i+1]);
         
-        fill(sequence[i],nums);
-        reverse_then_add(nums);
-        fill(sequence[i+1],next);
-        CU_ASSERT_STRING_EQUAL(nums,next);
-        
-        free(nums);
-        free(next);
+        free(str);
+        digits_free(&nums);
     }
 }
 
 void test_reverse_then_add3(void)
 {
-    char * num = malloc(MAX_DIG*sizeof(char));
+    struct digits num;
+    digits_init(&num);
     
-    fill("89",num);
+    fill("89",&num);
     for(int i=0; i<50; i++)
     {
-        reverse_then_add(num);
-        if(is_palindrome(num))
+        reverse_then_add(&num);
+        if(is_palindrome(&num))
         {
-            char answer[MAX_DIG];
-            fill("8813200023188",answer);
-            CU_ASSERT_STRING_EQUAL(num,answer);
+            char *str=to_str(&num);
+            CU_ASSERT_STRING_EQUAL(str,"8813200023188");
+            free(str);
             break;
         }
             
     }
     
-    free(num);
+    digits_free(&num);
 }
 
 void test_odds(void)
 {
-    char * num = malloc(MAX_DIG*sizeof(char));
-    fill("196",num);
-    CU_ASSERT_STRING_EQUAL(odds(num),"169");
-    fill("121",num);
-    CU_ASSERT_STRING_EQUAL(odds(num),"2");
-    fill("11",num);
-    CU_ASSERT_STRING_EQUAL(odds(num),"");
-    fill("887",num);
-    CU_ASSERT_STRING_EQUAL(odds(num),"7");
-    fill("111899999",num);
-    CU_ASSERT_STRING_EQUAL(odds(num),"189");
-    fill("8813200023188",num);
-    CU_ASSERT_STRING_EQUAL(odds(num),"0");
-    fill("0123456789",num);
-    CU_ASSERT_STRING_EQUAL(odds(num),"0123456789");
-    
-    free(num);
+    struct digits num;
+    digits_init(&num);
+    char *odds_arr;
+    char *seeds[]={"196", "121", "11", "887", "111899999", "8813200023188", "0123456789"};
+    char *answers[]={"169", "2", "", "7", "189", "0", "0123456789"};
+    
+    for(int i=0; i<7; i++)
+    {
+        fill(seeds[i],&num);
+        odds_arr=odds(&num);
+        CU_ASSERT_STRING_EQUAL(odds_arr,answers[i]);
+        free(odds_arr);
+    }
+    
+    digits_free(&num);
 }
 
 void test_fd_ld_equal(void)
 {
-    char * num = malloc(MAX_DIG*sizeof(char));
-    
-    fill("196",num);
-    CU_ASSERT_EQUAL(fd_ld_equal(num),false);
-    fill("11",num);
-    CU_ASSERT_EQUAL(fd_ld_equal(num),true);
-    fill("887",num);
-    CU_ASSERT_EQUAL(fd_ld_equal(num),false);
-    fill("8813200023188",num);
-    CU_ASSERT_EQUAL(fd_ld_equal(num),true);
-    fill("89",num);
-    CU_ASSERT_EQUAL(fd_ld_equal(num),false);
-    
-    free(num);
+    struct digits num;
+    digits_init(&num);
+    
+    fill("196",&num);
+    CU_ASSERT_EQUAL(fd_ld_equal(&num),false);
+    fill("11",&num);
+    CU_ASSERT_EQUAL(fd_ld_equal(&num),true);
+    fill("887",&num);
+    CU_ASSERT_EQUAL(fd_ld_equal(&num),false);
+    fill("8813200023188",&num);
+    CU_ASSERT_EQUAL(fd_ld_equal(&num),true);
+    fill("89",&num);
+    CU_ASSERT_EQUAL(fd_ld_equal(&num),false);
+    
+    digits_free(&num);
 }
 
 void test_cld_crd_equal(void)
 {
-    char * num = malloc(MAX_DIG*sizeof(char));
-    
-    fill("196",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),false);
-    fill("11",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),true);
-    fill("887",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),false);
-    fill("8813200023188",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),true);
-    fill("89",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),false);
-    fill("187088",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),false);
-    fill("8801197801088",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),false);
-    fill("897100798",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),false);
-    fill("18408442064004592449047",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),false);
-    fill("12311",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),false);
-    fill("12320",num);
-    CU_ASSERT_EQUAL(cld_crd_equal(num),true);
-    
-    free(num);
+    struct digits num;
+    digits_init(&num);
+    
+    fill("196",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),false);
+    fill("11",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),true);
+    fill("887",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),false);
+    fill("8813200023188",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),true);
+    fill("89",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),false);
+    fill("187088",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),false);
+    fill("8801197801088",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),false);
+    fill("897100798",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),false);
+    fill("18408442064004592449047",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),false);
+    fill("12311",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),false);
+    fill("12320",&num);
+    CU_ASSERT_EQUAL(cld_crd_equal(&num),true);
+    
+    digits_free(&num);
 }
 
 void test_average(void)
 {
-    char * num = malloc(MAX_DIG*sizeof(char));
+    struct digits num;
+    digits_init(&num);
+    
+    fill("196",&num);
+    CU_ASSERT_DOUBLE_EQUAL(5.33,average(&num),0.1);
+    fill("11",&num);
+    CU_ASSERT_DOUBLE_EQUAL(1.0,average(&num),0.1);
+    fill("8813200023188",&num);
+    CU_ASSERT_DOUBLE_EQUAL(3.38,average(&num),0.1);
+    fill("89",&num);
+    CU_ASSERT_DOUBLE_EQUAL(8.50,average(&num),0.1);
+    
+    digits_free(&num);
+}
+
+void test_long_number(void)
+{
+    struct digits num;
+    digits_init(&num);
+    char *nines=malloc(1001*sizeof(char));
+    memset(nines,'9',1000);
+    nines[1000]='\0';
+    
+    fill(nines,&num); // 99..9 + 99..9 = 199..98, far beyond old 100 char limit
+    reverse_then_add(&num);
+    CU_ASSERT(num.len==1001);
+    CU_ASSERT(num.cap>=num.len);
+    CU_ASSERT(num.dig[1000]==1);
+    CU_ASSERT(num.dig[0]==8);
+    CU_ASSERT(all_digits(&num));
+    CU_ASSERT_DOUBLE_EQUAL(9.0,average(&num),0.01);
+    
+    fill("196",&num);
+    for(int i=0; i<2000; i++)
+        reverse_then_add(&num);
+    CU_ASSERT(num.len>800);
+    CU_ASSERT(all_digits(&num));
+    CU_ASSERT_EQUAL(is_palindrome(&num),false);
+    
+    free(nines);
+    digits_free(&num);
+}
+
+void test_reverse_then_add_in_place(void)
+{
+    struct digits num;
+    struct digits rev;
+    digits_init(&num);
+    digits_init(&rev);
+    char *str;
+    char *seeds[]={"1", "5", "9", "19", "91", "505", "989", "1999", "99999", "123456789"};
+    char *answers[]={"2", "10", "18", "110", "110", "1010", "1978", "11990", "199998", "1111111110"};
+    
+    for(int i=0; i<10; i++)
+    {
+        fill(seeds[i],&num);
+        reverse_then_add(&num);
+        str=to_str(&num);
+        CU_ASSERT_STRING_EQUAL(str,answers[i]);
+        free(str);
+    }
+    
+    fill("196",&num); // against a copy reversed in the old way
+    for(int i=0; i<300; i++)
+    {
+        reverse(&num,&rev);
+        int carry=0;
+        for(size_t k=0; k<rev.len; k++)
+        {
+            int sum=rev.dig[k]+num.dig[k]+carry;
+            rev.dig[k]=(unsigned char)(sum%10);
+            carry=sum/10;
+        }
+        reverse_then_add(&num);
+        CU_ASSERT(num.len==rev.len+(size_t)carry);
+        CU_ASSERT(memcmp(num.dig,rev.dig,rev.len)==0);
+    }
+    
+    digits_free(&num);
+    digits_free(&rev);
+}
+
+void test_add_ops(void)
+{
+    struct digits num;
+    struct digits ref;
+    digits_init(&num);
+    digits_init(&ref);
+    struct add_ops best=add_ops;
+    struct add_ops scalar={pair_sums_scalar, carry_scalar, pairs_scalar, mirror_scalar, "scalar"};
+    char *str=malloc(401*sizeof(char));
+    char const *patterns[]={"0123456789", "9", "45", "54", "90", "09"}; // sums of 9 make long carry chains
+    
+    srand(35);
+    for(size_t n=1; n<=400; n++)
+    {
+        for(int p=0; p<7; p++)
+        {
+            for(size_t k=0; k<n; k++)
+            {
+                if(p==6)
+                    str[k]=(char)('0'+rand()%10);
+                else
+                    str[k]=patterns[p][k%strlen(patterns[p])];
+            }
+            str[0]=(str[0]=='0' ? '1' : str[0]);
+            str[n]='\0';
+            
+            fill(str,&num);
+            fill(str,&ref);
+            for(int r=0; r<3; r++)
+            {
+                add_ops=best;
+                reverse_then_add(&num);
+                add_ops=scalar;
+                reverse_then_add(&ref);
+            }
+            CU_ASSERT(num.len==ref.len);
+            CU_ASSERT(memcmp(num.dig,ref.dig,ref.len)==0);
+            CU_ASSERT(memcmp(num.count,ref.count,sizeof(ref.count))==0);
+        }
+    }
+    
+    add_ops=best;
+    free(str);
+    digits_free(&num);
+    digits_free(&ref);
+}
+
+void test_bcd(void)
+{
+    struct packed num;
+    struct digits ref;
+    struct digits out;
+    packed_init(&num,10);
+    digits_init(&ref);
+    digits_init(&out);
+    char *str;
+    
+    packed_fill("8813200023188",&num);
+    packed_to_digits(&num,&out);
+    str=to_str(&out);
+    CU_ASSERT_STRING_EQUAL(str,"8813200023188");
+    free(str);
+    
+    packed_fill("9999999999999999",&num); // carry out of a full word
+    reverse_then_add_packed(&num);
+    packed_to_digits(&num,&out);
+    str=to_str(&out);
+    CU_ASSERT_STRING_EQUAL(str,"19999999999999998");
+    free(str);
+    
+    char *seeds[]={"196", "89", "1", "9", "10", "1999999999999999", "123456789012345678901234567890123"};
+    for(int i=0; i<7; i++)
+    {
+        packed_fill(seeds[i],&num);
+        fill(seeds[i],&ref);
+        for(int r=0; r<400; r++)
+        {
+            reverse_then_add_packed(&num);
+            reverse_then_add(&ref);
+        }
+        packed_to_digits(&num,&out);
+        CU_ASSERT(out.len==ref.len);
+        CU_ASSERT(memcmp(out.dig,ref.dig,ref.len)==0);
+    }
+    
+    packed_free(&num);
+    digits_free(&ref);
+    digits_free(&out);
+}
+
+void test_count(void)
+{
+    struct digits num;
+    digits_init(&num);
+    size_t count[10];
+    
+    fill("8813200023188",&num);
+    CU_ASSERT(num.count[0]==3);
+    CU_ASSERT(num.count[8]==4);
+    CU_ASSERT(num.count[9]==0);
+    
+    fill("196",&num); // histogram of reverse_then_add against a recount
+    for(int i=0; i<3000; i++)
+    {
+        reverse_then_add(&num);
+        if(i%100!=0)
+            continue;
+        memset(count, 0, sizeof(count));
+        for(size_t k=0; k<num.len; k++)
+            count[num.dig[k]]++;
+        CU_ASSERT(memcmp(count,num.count,sizeof(count))==0);
+    }
+    
+    digits_free(&num);
+}
+
+void test_first_kin(void)
+{
+    CU_ASSERT(first_kin(7)==7);
+    CU_ASSERT(first_kin(196)==196);
+    CU_ASSERT(first_kin(691)==196);
+    CU_ASSERT(first_kin(286)==187);
+    CU_ASSERT(first_kin(98)==89);
+    CU_ASSERT(first_kin(10)==10);
+    CU_ASSERT(first_kin(1991)==1991);
+    CU_ASSERT(first_kin(2981)==1892);
+    CU_ASSERT(first_kin(9999)==9999);
+    
+    struct digits num;
+    struct digits kin;
+    digits_init(&num);
+    digits_init(&kin);
+    for(uint64_t n=10; n<3000; n++) // same first iterate
+    {
+        fill_number(n,&num);
+        fill_number(first_kin(n),&kin);
+        reverse_then_add(&num);
+        reverse_then_add(&kin);
+        CU_ASSERT(num.len==kin.len && memcmp(num.dig,kin.dig,num.len)==0);
+    }
+    digits_free(&num);
+    digits_free(&kin);
+}
+
+void test_scan_range(void)
+{
+    struct scan_result res1;
+    struct scan_result res4;
+    struct scan_result res0;
+    
+    scan_range(1,1000,100,1,MEMO_BITS,&res1);
+    CU_ASSERT(res1.n_cand==3); // 13 candidates below 1000, the others are kin of these
+    CU_ASSERT(res1.n_cand==3 && res1.cand[0]==196 && res1.cand[1]==689 && res1.cand[2]==879);
+    CU_ASSERT(res1.seeds+res1.related==999);
+    CU_ASSERT(res1.steps[24]>0); // 89
+    
+    scan_range(1,1000,100,4,MEMO_BITS,&res4);
+    CU_ASSERT(res4.seeds==res1.seeds);
+    CU_ASSERT(res4.related==res1.related);
+    CU_ASSERT(res4.n_cand==res1.n_cand);
+    CU_ASSERT(memcmp(res4.steps,res1.steps,101*sizeof(size_t))==0);
+    CU_ASSERT(memcmp(res4.cand,res1.cand,res1.n_cand*sizeof(uint64_t))==0);
+    result_free(&res1);
+    result_free(&res4);
+    
+    scan_range(1,30000,60,1,0,&res0); // no cache
+    scan_range(1,30000,60,1,MEMO_BITS,&res1);
+    scan_range(1,30000,60,1,6,&res4); // tiny cache, entries replaced all the time
+    CU_ASSERT(res0.memo==0);
+    CU_ASSERT(res1.memo>res1.seeds/3);
+    CU_ASSERT(res1.seeds==res0.seeds && res4.seeds==res0.seeds);
+    CU_ASSERT(memcmp(res1.steps,res0.steps,61*sizeof(size_t))==0);
+    CU_ASSERT(memcmp(res4.steps,res0.steps,61*sizeof(size_t))==0);
+    CU_ASSERT(res1.n_cand==res0.n_cand && res4.n_cand==res0.n_cand);
+    CU_ASSERT(memcmp(res1.cand,res0.cand,res0.n_cand*sizeof(uint64_t))==0);
+    CU_ASSERT(memcmp(res4.cand,res0.cand,res0.n_cand*sizeof(uint64_t))==0);
+    
+    result_free(&res0);
+    result_free(&res1);
+    result_free(&res4);
+}
+
+void test_par(void)
+{
+    struct digits num;
+    struct digits ref;
+    digits_init(&num);
+    digits_init(&ref);
+    struct par_info serial=par;
+    char *str=malloc(3001*sizeof(char));
+    
+    srand(39);
+    for(size_t n=1; n<=3000; n+=(n<200 ? 1 : 97))
+    {
+        for(size_t k=0; k<n; k++)
+            str[k]=(char)('0'+(k%3==0 ? 9 : rand()%10)); // many sums of 9 across chunks
+        str[0]='1';
+        str[n]='\0';
+        fill(str,&num);
+        fill(str,&ref);
+        for(int r=0; r<4; r++)
+        {
+            par=(struct par_info){.threads=1+(int)(n%5), .min_len=1};
+            reverse_then_add(&num);
+            par=serial;
+            reverse_then_add(&ref);
+        }
+        CU_ASSERT(num.len==ref.len);
+        CU_ASSERT(memcmp(num.dig,ref.dig,ref.len)==0);
+        CU_ASSERT(memcmp(num.count,ref.count,sizeof(ref.count))==0);
+    }
     
-    fill("196",num);
-    CU_ASSERT_DOUBLE_EQUAL(5.33,average(num),0.1);
-    fill("11",num);
-    CU_ASSERT_DOUBLE_EQUAL(1.0,average(num),0.1);
-    fill("8813200023188",num);
-    CU_ASSERT_DOUBLE_EQUAL(3.38,average(num),0.1);
-    fill("89",num);
-    CU_ASSERT_DOUBLE_EQUAL(8.50,average(num),0.1);
+    fill("99999999999999999999",&num); // carry runs through every chunk
+    par=(struct par_info){.threads=7, .min_len=1};
+    reverse_then_add(&num);
+    par=serial;
+    char *out=to_str(&num);
+    CU_ASSERT_STRING_EQUAL(out,"199999999999999999998");
+    
+    free(out);
+    free(str);
+    digits_free(&num);
+    digits_free(&ref);
+}
+
+void test_checkpoint(void)
+{
+    struct digits num;
+    struct digits back;
+    digits_init(&num);
+    digits_init(&back);
+    char const *name="test_196.ckpt";
+    
+    fill("196",&num);
+    for(int i=0; i<1000; i++)
+        reverse_then_add(&num);
+    save_checkpoint(name,&num,1000);
+    CU_ASSERT(load_checkpoint(name,&back)==1000);
+    CU_ASSERT(back.len==num.len);
+    CU_ASSERT(memcmp(back.dig,num.dig,num.len)==0);
+    CU_ASSERT(memcmp(back.count,num.count,sizeof(num.count))==0);
+    
+    reverse_then_add(&num); // resumed trajectory is the same
+    reverse_then_add(&back);
+    CU_ASSERT(memcmp(back.dig,num.dig,num.len)==0);
+    
+    remove(name);
+    digits_free(&num);
+    digits_free(&back);
+}
+
+void test_print_step(void)
+{
+    struct digits num;
+    digits_init(&num);
+    char line[256]={'\0'};
+    struct stats_record rec;
+    FILE *out=tmpfile();
+    CU_ASSERT_PTR_NOT_NULL(out);
+    if(out==NULL)
+        return;
+    
+    fill("8813200023188",&num);
+    print_step(out,OUT_CSV,&num,24);
+    print_step(out,OUT_BIN,&num,24);
+    rewind(out);
+    
+    CU_ASSERT_PTR_NOT_NULL(fgets(line,sizeof(line),out));
+    CU_ASSERT_STRING_EQUAL(line,"24,13,+,+,3.38,0\n");
+    CU_ASSERT(fread(&rec,sizeof(rec),1,out)==1);
+    CU_ASSERT(sizeof(rec)==104);
+    CU_ASSERT(rec.step==24 && rec.len==13);
+    CU_ASSERT(rec.count[8]==4 && rec.count[0]==3);
+    CU_ASSERT(rec.fd_ld==1 && rec.cl_cr==1);
+    
+    fclose(out);
+    digits_free(&num);
+}
+
+void test_radix(void)
+{
+    struct packed num;
+    struct digits ref;
+    struct digits out;
+    digits_init(&ref);
+    digits_init(&out);
+    char *str;
+    
+    CU_ASSERT(radix_steps("1011",2,10,1,NULL)==2); // 1011, 11000, 11011
+    CU_ASSERT(radix_steps("10110",2,500,1,NULL)==-1); // 22, smallest binary Lychrel number
+    CU_ASSERT(radix_steps("10110",3,50,1,NULL)>0);
+    
+    fill("17",&ref);
+    reverse_then_add_radix(&ref,8);
+    str=to_str(&ref);
+    CU_ASSERT_STRING_EQUAL(str,"110"); // octal 17+71
+    free(str);
+    CU_ASSERT(ref.count[1]==2 && ref.count[0]==1);
+    
+    packed_init(&num,16);
+    packed_fill("ff",&num);
+    reverse_then_add_packed(&num);
+    str=packed_to_str(&num);
+    CU_ASSERT_STRING_EQUAL(str,"1fe");
+    free(str);
+    CU_ASSERT(!packed_is_palindrome(&num));
+    packed_fill("abcdef0123456789876543210fedcba",&num);
+    CU_ASSERT(packed_is_palindrome(&num));
+    packed_free(&num);
+    
+    char pal[132];
+    for(int k=0; k<=65; k++)
+        pal[k]=pal[130-k]=(char)('0'+(k*k/3)%2);
+    pal[0]=pal[130]='1';
+    pal[131]='\0';
+    packed_init(&num,2);
+    packed_fill(pal,&num); // crosses two word boundaries
+    CU_ASSERT(packed_is_palindrome(&num));
+    num.word[1]^=1;
+    CU_ASSERT(!packed_is_palindrome(&num));
+    packed_free(&num);
+    
+    unsigned radices[]={2, 4};
+    char *seeds[]={"1", "10110", "1101001", "3", "1230321"};
+    for(int r=0; r<2; r++)
+    {
+        packed_init(&num,radices[r]);
+        for(int i=0; i<5; i++)
+        {
+            bool bad=false;
+            for(char *c=seeds[i]; *c; c++)
+                bad|=(digit_value(*c)>=radices[r]);
+            if(bad)
+                continue;
+            packed_fill(seeds[i],&num);
+            fill(seeds[i],&ref);
+            for(int k=0; k<300; k++)
+            {
+                reverse_then_add_packed(&num);
+                reverse_then_add_radix(&ref,radices[r]);
+                CU_ASSERT(packed_is_palindrome(&num)==is_palindrome(&ref));
+            }
+            packed_to_digits(&num,&out);
+            CU_ASSERT(out.len==ref.len);
+            CU_ASSERT(memcmp(out.dig,ref.dig,ref.len)==0);
+        }
+        packed_free(&num);
+    }
     
-    free(num);
+    digits_free(&ref);
+    digits_free(&out);
+}
+
+void test_run_steps(void)
+{
+    struct digits num;
+    struct digits back;
+    digits_init(&num);
+    digits_init(&back);
+    char const *name="test_196.ckpt";
+    FILE *out[2]={tmpfile(), tmpfile()};
+    CU_ASSERT_PTR_NOT_NULL(out[0]);
+    CU_ASSERT_PTR_NOT_NULL(out[1]);
+    if(out[0]==NULL || out[1]==NULL)
+        return;
+    
+    fill("196",&num);
+    CU_ASSERT(run_steps(&num,0,500,ENGINE_DIGITS,OUT_CSV,7,0,name,out[0])==500);
+    fill("196",&back);
+    CU_ASSERT(run_steps(&back,0,200,ENGINE_BCD,OUT_CSV,7,100,name,out[1])==200);
+    CU_ASSERT(load_checkpoint(name,&back)==200); // resumed on the other engine
+    CU_ASSERT(run_steps(&back,200,500,ENGINE_BCD,OUT_CSV,7,0,name,out[1])==500);
+    CU_ASSERT(back.len==num.len);
+    CU_ASSERT(memcmp(back.dig,num.dig,num.len)==0);
+    CU_ASSERT(memcmp(back.count,num.count,sizeof(num.count))==0);
+    CU_ASSERT(run_steps(&back,500,500,ENGINE_BCD,OUT_CSV,7,0,name,out[1])==500); // finished run takes no step
+    CU_ASSERT(back.len==num.len);
+    
+    char line[2][256];
+    int lines=0;
+    rewind(out[0]);
+    rewind(out[1]);
+    while(fgets(line[0],sizeof(line[0]),out[0])!=NULL)
+    {
+        CU_ASSERT_PTR_NOT_NULL(fgets(line[1],sizeof(line[1]),out[1]));
+        CU_ASSERT_STRING_EQUAL(line[0],line[1]);
+        lines++;
+    }
+    CU_ASSERT(lines==72);
+    CU_ASSERT(fgets(line[1],sizeof(line[1]),out[1])==NULL);
+    
+    remove(name);
+    fclose(out[0]);
+    fclose(out[1]);
+    digits_free(&num);
+    digits_free(&back);
 }
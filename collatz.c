@@ -10,6 +10,15 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <threads.h>
+#include <stdatomic.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_GLIDE // AVX2 lanes selected at run time
+#include <immintrin.h>
+#endif
 
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
@@ -33,55 +42,846 @@ struct info
 {
     uintmax_t max;
     uintmax_t steps;
+    unsigned max_bits; // 0 while max fits, else bits of the maximum and max is UINTMAX_MAX
 };
 struct info make_info(uintmax_t max,uintmax_t steps)
 {
-    const struct info info ={.max=max , .steps=steps};
+    const struct info info ={.max=max , .steps=steps, .max_bits=0};
     return info;
 }
 
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 wide_t; // trajectories past uintmax_t
+#else
+typedef uintmax_t wide_t;
+#endif
+#define WIDE_MAX ((wide_t)-1)
+#define WIDE_BITS (8*sizeof(wide_t))
+
+struct big // trajectories past wide_t, 32 bit limbs, least significant first
+{
+    uint32_t *limb;
+    size_t len;
+    size_t cap;
+};
+
+void big_from_wide(struct big *num, wide_t v)
+{
+    num->cap=WIDE_BITS/32+2;
+    num->limb=malloc(num->cap*sizeof(uint32_t));
+    if(num->limb==NULL)
+        simple_err("big allocation failed");
+    num->len=0;
+    while(v>0)
+    {
+        num->limb[num->len++]=(uint32_t)v;
+        v>>=32;
+    }
+}
+
+wide_t big_to_wide(struct big const *num) // num fits wide_t
+{
+    wide_t v=0;
+    for(size_t k=num->len; k>0; k--)
+        v=(v<<32)|num->limb[k-1];
+    return v;
+}
+
+unsigned big_bits(struct big const *num)
+{
+    unsigned bits=32*(unsigned)(num->len-1);
+    for(uint32_t top=num->limb[num->len-1]; top>0; top>>=1)
+        bits++;
+    return bits;
+}
+
+void big_halve(struct big *num)
+{
+    for(size_t k=0; k<num->len; k++)
+        num->limb[k]=(num->limb[k]>>1) | (k+1<num->len ? num->limb[k+1]<<31 : 0);
+    if(num->limb[num->len-1]==0)
+        num->len--;
+}
+
+void big_triple_plus_one(struct big *num)
+{
+    uint64_t carry=1;
+    for(size_t k=0; k<num->len; k++)
+    {
+        uint64_t t=(uint64_t)num->limb[k]*3+carry;
+        num->limb[k]=(uint32_t)t;
+        carry=t>>32;
+    }
+    if(carry==0)
+        return;
+    if(num->len==num->cap)
+    {
+        num->cap*=2;
+        uint32_t *limb=realloc(num->limb, num->cap*sizeof(uint32_t));
+        if(limb==NULL)
+            simple_err("big allocation failed");
+        num->limb=limb;
+    }
+    num->limb[num->len++]=(uint32_t)carry;
+}
+
+void big_max(struct info *info, unsigned bits)
+{
+    info->max=UINTMAX_MAX;
+    if(bits>info->max_bits)
+        info->max_bits=bits;
+}
+
+unsigned wide_bits(wide_t num)
+{
+    unsigned bits=0;
+    for(; num>0; num>>=1)
+        bits++;
+    return bits;
+}
+
 #define TRIES 100000// 1000000
-uintmax_t evens=0, odds=0;
-bool collatz(uintmax_t num, struct info *info) 
+#define MEMO_BOUND (UINTMAX_C(1)<<22) // most numbers kept by default, 12 bytes each
+#define JUMP_K 12 // steps of a jump table entry, 8 to 20
+#define CHUNK 65536 // numbers a thread takes at once
+#define MAX_THREADS 256
+#define BATCH 1024 // numbers handed to a glide kernel at once
+#define BENCH_START (UINTMAX_C(1)<<40) // first number of benchmark
+#define BENCH_COUNT 1000000
+thread_local uintmax_t evens=0, odds=0; // of this thread
+
+bool collatz_wide(wide_t num, struct info *info);
+
+bool collatz_big(wide_t num, struct info *info) // num is odd and 3*num+1 is past wide_t
 {
+    struct big big;
+    big_from_wide(&big,num);
     
-    if(num == 1)
+    while(big.len*32>WIDE_BITS || big_to_wide(&big)>(WIDE_MAX-1)/3) // back to wide_t when 3*num+1 fits
     {
+        info->steps++;
+        if(big.limb[0]%2 == 0)
+        {
+            big_max(info,big_bits(&big));
+            evens++;
+            big_halve(&big);
+        }
+        else
+        {
+            big_triple_plus_one(&big);
+            big_max(info,big_bits(&big));
+            odds++;
+        }
+    }
+    
+    num=big_to_wide(&big);
+    free(big.limb);
+    return collatz_wide(num,info);
+}
+
+bool collatz_wide(wide_t num, struct info *info) // as collatz, num may be past uintmax_t
+{
+    while(num != 1)
+    {
+        if(num%2 == 1 && num > (WIDE_MAX-1)/3)
+            return collatz_big(num,info);
         
-        if(info->steps >1 ) 
-            info->steps++;
-            
-        return true;
-    }	
+        info->steps++;
+        if(num%2 == 0)
+        {
+            if(num > UINTMAX_MAX)
+                big_max(info,wide_bits(num));
+            else if(num > info->max)
+                info->max=(uintmax_t)num;
+            evens++;
+            num/=2;
+        }
+        else
+        {
+            num=num*3+1;
+            if(num > UINTMAX_MAX)
+                big_max(info,wide_bits(num));
+            else if(num > info->max)
+                info->max=(uintmax_t)num;
+            odds++;
+        }
+    }
+    
+    if(info->steps >1 )
+        info->steps++;
+    return true;
+}
+
+bool collatz(uintmax_t num, struct info *info) // false for 0, steps of a longer trajectory count 1 itself
+{
+    if(num == 0)
+        return false;
+    
+    while(num != 1)
+    {
+        if(num%2 == 1 && num > (UINTMAX_MAX-1)/3) // 3*num+1 does not fit
+            return collatz_wide(num,info);
+        
+        info->steps++;
+        if(num % 2 == 0)
+        {
+            if(num > info->max)
+                info->max=num;
+            evens++;
+            num/=2;
+        }
+        else
+        {
+            num=num*3+1;
+            if(num > info->max)
+                info->max=num;
+            odds++;
+        }
+    }
+    
+    if(info->steps >1 )
+        info->steps++;
+    return true;
+}
+
+struct jump_entry // k steps of n -> n/2 or (3n+1)/2 from n=a*2^k+r, r is the index
+{
+    uint64_t add; // n goes to 3^odd*a+add
+    uint64_t peak_mul; // values on the way, 3n+1 too, are at most peak_mul*a+peak_add
+    uint64_t peak_add;
+    unsigned odd;
+};
+
+struct jump_table
+{
+    struct jump_entry *entry;
+    uint64_t pow3[21];
+    unsigned k;
+};
+
+void jump_table_init(struct jump_table *jt, unsigned k)
+{
+    if(k<8 || k>20)
+        simple_err("jump table k is 8 to 20");
+    jt->k=k;
+    jt->pow3[0]=1;
+    for(int c=1; c<=20; c++)
+        jt->pow3[c]=3*jt->pow3[c-1];
+    jt->entry=malloc(((size_t)1<<k)*sizeof(struct jump_entry));
+    if(jt->entry==NULL)
+        simple_err("jump table allocation failed");
+    
+    for(uint64_t r=0; r < ((uint64_t)1<<k); r++)
+    {
+        uint64_t mul=(uint64_t)1<<k, add=r; // value is mul*a+add, mul is even before step k
+        struct jump_entry e={.peak_mul=mul, .peak_add=add, .odd=0};
+        for(unsigned j=0; j<k; j++)
+        {
+            if(add%2 == 1)
+            {
+                mul*=3;
+                add=add*3+1;
+                e.odd++;
+                if(mul > e.peak_mul)
+                    e.peak_mul=mul;
+                if(add > e.peak_add)
+                    e.peak_add=add;
+            }
+            mul/=2;
+            add/=2;
+        }
+        e.add=add;
+        jt->entry[r]=e;
+    }
+}
+
+void jump_table_free(struct jump_table *jt)
+{
+    free(jt->entry);
+}
+
+// k steps at once for n of at least 2^k, where no value of the jump is 1, false when n has to be
+// stepped one by one since the jump may pass max or uintmax_t
+static inline bool jump(uintmax_t *n, uintmax_t max, uintmax_t *trans, uintmax_t *odd, struct jump_table const *jt)
+{
+    uintmax_t a=*n >> jt->k;
+    struct jump_entry const *e=jt->entry + (*n & (((uintmax_t)1<<jt->k)-1));
+    uintmax_t peak;
+    
+    if(a == 0 || __builtin_mul_overflow(e->peak_mul,a,&peak) || __builtin_add_overflow(peak,e->peak_add,&peak) || peak > max)
+        return false;
+    *n=jt->pow3[e->odd]*a+e->add;
+    *trans+=jt->k+e->odd;
+    *odd+=e->odd;
+    return true;
+}
+
+struct memo // trajectories of n below bound, trans[n] is 0 until n is known, shared by threads
+{
+    _Atomic(uint16_t) *trans; // steps to 1, stored last with release
+    _Atomic(uint16_t) *odd; // 3n+1 steps of those
+    _Atomic(uintmax_t) *max;
+    uintmax_t bound;
+};
+
+void memo_init(struct memo *memo, uintmax_t bound)
+{
+    memo->bound=bound;
+    memo->trans=calloc(bound,sizeof(*memo->trans));
+    memo->odd=calloc(bound,sizeof(*memo->odd));
+    memo->max=calloc(bound,sizeof(*memo->max));
+    if(memo->trans==NULL || memo->odd==NULL || memo->max==NULL)
+        simple_err("memo allocation failed");
+}
+
+void memo_free(struct memo *memo)
+{
+    free(memo->trans);
+    free(memo->odd);
+    free(memo->max);
+}
+
+// as collatz, the walk stops at a known number below bound and adds its tail, and takes
+// jumps of the table, memo and jt may be NULL, trajectories past uintmax_t are left to collatz and not kept
+bool collatz_memo(uintmax_t num, struct info *info, struct memo *memo, struct jump_table const *jt)
+{
+    uintmax_t n=num;
+    uintmax_t trans=0, odd=0, max=1;
+    uint16_t known=0; // steps of tail
     
-    info->steps++;
+    if(num == 0)
+        return false;
+    while(n != 1)
+    {
+        if(memo != NULL && n < memo->bound && (known=atomic_load_explicit(&memo->trans[n],memory_order_acquire)) != 0)
+            break;
+        if(jt != NULL && (memo == NULL || n >= memo->bound) && jump(&n,max,&trans,&odd,jt)) // below bound, step to the first known number
+            continue;
+        if(n%2 == 1 && n > (UINTMAX_MAX-1)/3)
+            return collatz(num,info);
         
-    if(num % 2 == 0)
+        trans++;
+        if(n%2 == 0)
+        {
+            if(n > max)
+                max=n;
+            n/=2;
+        }
+        else
+        {
+            n=n*3+1;
+            if(n > max)
+                max=n;
+            odd++;
+        }
+    }
+    
+    if(known != 0)
+    {
+        trans+=known;
+        odd+=atomic_load_explicit(&memo->odd[n],memory_order_relaxed);
+        uintmax_t tail_max=atomic_load_explicit(&memo->max[n],memory_order_relaxed);
+        if(tail_max > max)
+            max=tail_max;
+    }
+    if(memo != NULL && num < memo->bound && trans <= UINT16_MAX)
+    {
+        atomic_store_explicit(&memo->odd[num],(uint16_t)odd,memory_order_relaxed);
+        atomic_store_explicit(&memo->max[num],max,memory_order_relaxed);
+        atomic_store_explicit(&memo->trans[num],(uint16_t)trans,memory_order_release);
+    }
+    
+    evens+=trans-odd;
+    odds+=odd;
+    if(max > info->max)
+        info->max=max;
+    info->steps+=trans;
+    if(info->steps >1 )
+        info->steps++;
+    return true;
+}
+
+struct glide_info // path of num until a value below num
+{
+    uintmax_t steps;
+    wide_t max;
+};
+
+bool glide_wide(wide_t n, uintmax_t num, struct glide_info *g) // n past uintmax_t, false if it passes wide_t too
+{
+    while(n >= num)
+    {
+        if(n%2 == 1 && n > (WIDE_MAX-1)/3)
+            return false;
+        g->steps++;
+        if(n%2 == 0)
+            n/=2;
+        else
+        {
+            n=n*3+1;
+            if(n > g->max)
+                g->max=n;
+        }
+    }
+    return true;
+}
+
+bool glide(uintmax_t num, struct glide_info *g) // steps of 1 are 0
+{
+    uintmax_t n=num;
+    g->steps=0;
+    g->max=num;
+    if(num <= 1)
+        return true;
+    
+    while(n >= num)
+    {
+        if(n%2 == 1 && n > (UINTMAX_MAX-1)/3)
+            return glide_wide(n,num,g);
+        g->steps++;
+        if(n%2 == 0)
+            n/=2;
+        else
+        {
+            n=n*3+1;
+            if(n > g->max)
+                g->max=n;
+        }
+    }
+    return true;
+}
+
+struct sieve // residues mod 2^k of numbers not shown to drop below themselves in k steps, ascending
+{
+    uint32_t *res;
+    size_t n;
+    size_t cap;
+    unsigned k;
+};
+
+// class r mod 2^j has T^j(2^j*a+r) = 3^c*a+x, with 3^c < 2^j and x <= r every number of it
+// from 2^j on drops below itself, else the class splits on bit j
+void sieve_grow(struct sieve *sv, uint64_t r, unsigned j, uint64_t x, uint64_t pow3)
+{
+    if(pow3 < ((uint64_t)1<<j) && x <= r)
+        return;
+    if(j == sv->k)
+    {
+        if(sv->n == sv->cap)
+        {
+            sv->cap=(sv->cap == 0 ? 64 : 2*sv->cap);
+            uint32_t *res=realloc(sv->res, sv->cap*sizeof(uint32_t));
+            if(res == NULL)
+                simple_err("sieve allocation failed");
+            sv->res=res;
+        }
+        sv->res[sv->n++]=(uint32_t)r;
+        return;
+    }
+    
+    for(uint64_t b=0; b<2; b++) // a=2a'+b
+    {
+        uint64_t v=x+b*pow3;
+        if(v%2 == 0)
+            sieve_grow(sv, r|(b<<j), j+1, v/2, pow3);
+        else
+            sieve_grow(sv, r|(b<<j), j+1, (3*v+1)/2, 3*pow3);
+    }
+}
+
+int cmp_u32(const void *x, const void *y)
+{
+    uint32_t u=*(const uint32_t *)x;
+    uint32_t v=*(const uint32_t *)y;
+    return (u>v)-(u<v);
+}
+
+void sieve_init(struct sieve *sv, unsigned k)
+{
+    if(k<1 || k>32)
+        simple_err("sieve k is 1 to 32");
+    sv->res=NULL;
+    sv->n=0;
+    sv->cap=0;
+    sv->k=k;
+    sieve_grow(sv,0,0,0,1);
+    qsort(sv->res, sv->n, sizeof(uint32_t), cmp_u32);
+}
+
+void sieve_free(struct sieve *sv)
+{
+    free(sv->res);
+}
+
+struct verify_result // records of numbers followed until they drop below themselves
+{
+    uintmax_t checked;
+    uintmax_t glide; // most steps
+    uintmax_t glide_n;
+    wide_t max; // largest value
+    uintmax_t max_n;
+};
+
+void record(struct verify_result *res, uintmax_t n, uintmax_t steps, wide_t max) // ties go to smaller numbers
+{
+    res->checked++;
+    if(steps > res->glide || (steps == res->glide && n < res->glide_n))
+    {
+        res->glide=steps;
+        res->glide_n=n;
+    }
+    if(max > res->max || (max == res->max && n < res->max_n))
+    {
+        res->max=max;
+        res->max_n=n;
+    }
+}
+
+void verify_one(uintmax_t n, struct verify_result *res)
+{
+    struct glide_info g;
+    if(!glide(n,&g))
+        simple_err("trajectory passes 128 bits");
+    record(res,n,g.steps,g.max);
+}
+
+struct glide_ops
+{
+    void (*batch)(uintmax_t const *num, size_t count, struct verify_result *res);
+    char const *name;
+};
+
+void batch_scalar(uintmax_t const *num, size_t count, struct verify_result *res)
+{
+    for(size_t i=0; i<count; i++)
+        verify_one(num[i],res);
+}
+
+static struct glide_ops glide_ops = {batch_scalar, "scalar"};
+
+#ifdef SIMD_GLIDE
+__attribute__((target("avx2"))) static inline __m256i less_u64(__m256i a, __m256i b) // unsigned a<b in every lane
+{
+    __m256i const sign=_mm256_set1_epi64x((long long)0x8000000000000000ULL);
+    return _mm256_cmpgt_epi64(_mm256_xor_si256(b,sign),_mm256_xor_si256(a,sign));
+}
+
+// 4 glides at once with n -> n/2 or (3n+1)/2, a lane drops out below its start and takes the next number,
+// idle lanes hold 1, which never drops, lanes whose 3n+1 would pass 64 bits are done by glide,
+// and numbers not 3 mod 4 too since they are done in 3 steps
+__attribute__((target("avx2"))) void batch_avx2(uintmax_t const *num, size_t count, struct verify_result *res)
+{
+    uint64_t n[4], start[4], steps[4], max[4];
+    size_t next=0;
+    unsigned active=0;
+    
+    for(int l=0; l<4; l++)
     {
+        n[l]=start[l]=max[l]=1;
+        steps[l]=0;
+    }
+    
+    __m256i const one=_mm256_set1_epi64x(1);
+    __m256i const limit=_mm256_set1_epi64x((long long)((UINT64_MAX-1)/3));
+    while(true)
+    {
+        for(int l=0; l<4; l++) // fill idle lanes
+        {
+            while(!(active & (1u<<l)) && next < count)
+            {
+                uint64_t m=num[next++];
+                if(m%4 != 3) // 1, or drops in 3 steps at most
+                {
+                    verify_one(m,res);
+                    continue;
+                }
+                n[l]=start[l]=max[l]=m;
+                steps[l]=0;
+                active|=1u<<l;
+            }
+        }
+        if(active == 0)
+            break;
+        
+        __m256i vn=_mm256_loadu_si256((__m256i const *)n);
+        __m256i vs=_mm256_loadu_si256((__m256i const *)start);
+        __m256i vsteps=_mm256_loadu_si256((__m256i const *)steps);
+        __m256i vmax=_mm256_loadu_si256((__m256i const *)max);
+        unsigned done=0, over=0;
+        do
+        {
+            __m256i odd=_mm256_cmpeq_epi64(_mm256_and_si256(vn,one),one);
+            over=(unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_and_si256(odd,less_u64(limit,vn))));
+            if(over)
+                break;
+            __m256i t=_mm256_add_epi64(_mm256_add_epi64(_mm256_slli_epi64(vn,1),vn),one); // 3n+1
+            vmax=_mm256_blendv_epi8(vmax,t,_mm256_and_si256(odd,less_u64(vmax,t)));
+            vn=_mm256_srli_epi64(_mm256_blendv_epi8(vn,t,odd),1);
+            vsteps=_mm256_add_epi64(vsteps,_mm256_sub_epi64(one,odd)); // 2 for odd, odd is -1
+            done=(unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(less_u64(vn,vs)));
+        }while(done == 0);
+        _mm256_storeu_si256((__m256i *)n,vn);
+        _mm256_storeu_si256((__m256i *)steps,vsteps);
+        _mm256_storeu_si256((__m256i *)max,vmax);
         
-        uintmax_t en=num/2;
-        if(num > info->max)
-            info->max=num; 
-        evens++;
-        return collatz(en,info);
-    }	
-    else 
+        for(int l=0; l<4; l++)
+        {
+            if(over & (1u<<l))
+                verify_one(start[l],res);
+            else if(done & (1u<<l))
+                record(res,start[l],steps[l],max[l]);
+            else
+                continue;
+            n[l]=start[l]=max[l]=1;
+            active&=~(1u<<l);
+        }
+    }
+}
+#endif // SIMD_GLIDE
+
+void glide_ops_init(void)
+{
+#ifdef SIMD_GLIDE
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        glide_ops.batch=batch_avx2;
+        glide_ops.name="avx2";
+    }
+#endif // SIMD_GLIDE
+}
+
+void push(uintmax_t m, uintmax_t *buf, size_t *count, struct verify_result *res)
+{
+    buf[(*count)++]=m;
+    if(*count == BATCH)
+    {
+        glide_ops.batch(buf,*count,res);
+        *count=0;
+    }
+}
+
+void verify_range(uintmax_t a, uintmax_t b, struct sieve const *sv, struct verify_result *res) // [a,b), sv NULL for all
+{
+    uintmax_t buf[BATCH];
+    size_t count=0;
+    uintmax_t n=a;
+    *res=(struct verify_result){.checked=0, .glide=0, .glide_n=0, .max=0, .max_n=0};
+    
+    // below 2^k all of them, one by one, 3 of 4 drop in 3 steps and would stall the lanes of glide_ops
+    for(; n<b && (sv == NULL || n < ((uintmax_t)1<<sv->k)); n++)
+        verify_one(n,res);
+    
+    uintmax_t mod=(sv == NULL ? 0 : (uintmax_t)1<<sv->k);
+    for(uintmax_t base=(n<b ? n-n%mod : b); base<b; base+=mod)
+    {
+        for(size_t i=0; i<sv->n; i++)
+        {
+            uintmax_t m=base+sv->res[i];
+            if(m >= b)
+                break;
+            if(m >= n)
+                push(m,buf,&count,res);
+        }
+        if(base > UINTMAX_MAX-mod)
+            break;
+    }
+    glide_ops.batch(buf,count,res);
+}
+
+struct range_job // one thread of a range run
+{
+    uintmax_t a;
+    uintmax_t b;
+    uintmax_t chunk;
+    atomic_uintmax_t *next; // first number of next chunk
+    struct memo *memo; // for trajectories to 1
+    struct jump_table const *jt; // above memo bound, may be NULL
+    struct sieve const *sv; // for verification
+    
+    uintmax_t evens; // results of this thread
+    uintmax_t odds;
+    uintmax_t steps; // record trajectory to 1
+    uintmax_t steps_n;
+    uintmax_t max;
+    uintmax_t max_n;
+    unsigned max_bits;
+    struct verify_result res;
+};
+
+bool take_chunk(struct range_job *job, uintmax_t *beg, uintmax_t *end)
+{
+    *beg=atomic_fetch_add(job->next, job->chunk);
+    if(*beg >= job->b)
+        return false;
+    *end=(job->b-*beg > job->chunk ? *beg+job->chunk : job->b);
+    return true;
+}
+
+int stats_worker(void *arg) // trajectories to 1, counters are thread local
+{
+    struct range_job *job=arg;
+    uintmax_t beg, end;
+    evens=0;
+    odds=0;
+    
+    while(take_chunk(job,&beg,&end))
+    {
+        for(uintmax_t n=beg; n<end; n++)
+        {
+            struct info info=make_info(1,0);
+            collatz_memo(n,&info,job->memo,job->jt);
+            if(info.steps > job->steps || (info.steps == job->steps && n < job->steps_n))
+            {
+                job->steps=info.steps;
+                job->steps_n=n;
+            }
+            if(info.max_bits > job->max_bits || (info.max_bits == job->max_bits && info.max > job->max)
+               || (info.max_bits == job->max_bits && info.max == job->max && n < job->max_n))
+            {
+                job->max=info.max;
+                job->max_bits=info.max_bits;
+                job->max_n=n;
+            }
+        }
+    }
+    
+    job->evens=evens;
+    job->odds=odds;
+    return 0;
+}
+
+void merge_verify(struct verify_result *res, struct verify_result const *part) // ties go to smaller numbers
+{
+    res->checked+=part->checked;
+    if(part->glide > res->glide || (part->glide == res->glide && part->glide_n < res->glide_n))
+    {
+        res->glide=part->glide;
+        res->glide_n=part->glide_n;
+    }
+    if(part->max > res->max || (part->max == res->max && part->max_n < res->max_n))
+    {
+        res->max=part->max;
+        res->max_n=part->max_n;
+    }
+}
+
+int verify_worker(void *arg)
+{
+    struct range_job *job=arg;
+    uintmax_t beg, end;
+    struct verify_result part;
+    
+    job->res=(struct verify_result){.checked=0, .glide=0, .glide_n=0, .max=0, .max_n=0};
+    while(take_chunk(job,&beg,&end))
+    {
+        verify_range((beg < job->a ? job->a : beg),end,job->sv,&part); // first chunk starts at a multiple of 2^k
+        merge_verify(&job->res,&part);
+    }
+    return 0;
+}
+
+// numbers a to b-1 in chunks, every thread has a job, memo NULL with sv for verification, jt may be NULL
+void range_run(uintmax_t a, uintmax_t b, int threads, struct memo *memo, struct jump_table const *jt, struct sieve const *sv, struct range_job *job)
+{
+    thrd_t thr[MAX_THREADS];
+    atomic_uintmax_t next=a;
+    uintmax_t chunk=CHUNK;
+    int t;
+    
+    if(threads<1 || threads>MAX_THREADS)
+        simple_err("threads out of range");
+    if(sv != NULL && chunk < ((uintmax_t)1<<sv->k)) // a chunk goes over every survivor once at least
+        chunk=(uintmax_t)1<<sv->k;
+    if(sv != NULL)
+        next=a-a%chunk;
+    
+    for(t=0; t<threads; t++)
+    {
+        job[t]=(struct range_job){.a=a, .b=b, .chunk=chunk, .next=&next, .memo=memo, .jt=jt, .sv=sv, .max=0, .max_n=0};
+        if(thrd_create(&thr[t], (memo != NULL ? stats_worker : verify_worker), &job[t])!=thrd_success)
+            simple_err("thread creation failed");
+    }
+    for(t=0; t<threads; t++)
+        thrd_join(thr[t], NULL);
+}
+
+void print_wide(wide_t v)
+{
+    if(v >= 10)
+        print_wide(v/10);
+    putchar('0'+(int)(v%10));
+}
+
+void bench_collatz(struct jump_table const *jt) // jt NULL for collatz
+{
+    clock_t beg=clock();
+    for(uintmax_t n=BENCH_START; n<BENCH_START+BENCH_COUNT; n++)
     {
-        assert(num %2 ==1);
-        uintmax_t on=num*3+1;
-        if(on > info->max)
-            info->max=on;
-        odds++;
-        return collatz(on,info);
+        struct info info=make_info(1,0);
+        if(jt == NULL)
+            collatz(n,&info);
+        else
+            collatz_memo(n,&info,NULL,jt);
     }
-    return false;
+    double sec=(double)(clock()-beg)/CLOCKS_PER_SEC;
+    if(jt == NULL)
+        printf("collatz: ");
+    else
+        printf("jump k=%u: ", jt->k);
+    printf("%d numbers from 2^40 in %.3f s, %.3g numbers/s\n", BENCH_COUNT, sec, BENCH_COUNT/sec);
+}
+
+void bench_verify(unsigned k) // numbers from 2^40 verified a second, k 0 for no sieve
+{
+    struct sieve sv;
+    struct verify_result res;
+    if(k > 0)
+        sieve_init(&sv,k);
+    uintmax_t count=(k > 0 ? 50 : 4)*(uintmax_t)BENCH_COUNT;
+    clock_t beg=clock();
+    verify_range(BENCH_START,BENCH_START+count,(k > 0 ? &sv : NULL),&res);
+    double sec=(double)(clock()-beg)/CLOCKS_PER_SEC;
+    printf("verify %s sieve k=%u: %ju numbers (%ju followed) in %.3f s, %.3g numbers/s\n",
+           (k > 0 ? glide_ops.name : "scalar"), k, count, res.checked, sec, count/sec);
+    if(k > 0)
+        sieve_free(&sv);
 }
 
 void test_collatz(void);
+void test_collatz_wide(void);
+void test_collatz_memo(void);
+void test_jump_table(void);
+void test_sieve(void);
+void test_range_run(void);
+void test_glide_ops(void);
 
-int main(void)
+int main(int argc, char *argv[])
 {
+    glide_ops_init();
+    
+#ifdef BENCH
+    struct glide_ops best=glide_ops;
+    glide_ops=(struct glide_ops){batch_scalar, "scalar"};
+    bench_verify(0);
+    bench_verify(16);
+    glide_ops=best;
+    if(glide_ops.batch != batch_scalar) // only sieve survivors go to the kernel
+        bench_verify(16);
+    bench_collatz(NULL);
+    for(unsigned k=8; k<=20; k+=4)
+    {
+        struct jump_table jt;
+        jump_table_init(&jt,k);
+        bench_collatz(&jt);
+        jump_table_free(&jt);
+    }
+    return 0;
+#endif // BENCH
+
 #ifndef NDEBUG
+    (void)argc;
+    (void)argv;
     int cui;
 
     cui = CU_initialize_registry();
@@ -96,21 +896,126 @@ int main(void)
     CU_pTest test1 = CU_add_test(suite1, "test_collatz", test_collatz);
     if(test1 == NULL)
         simple_err("test1 creation failed.");
+    CU_pTest test2 = CU_add_test(suite1, "test_collatz_wide", test_collatz_wide);
+    if(test2 == NULL)
+        simple_err("test2 creation failed.");
+    CU_pTest test3 = CU_add_test(suite1, "test_collatz_memo", test_collatz_memo);
+    if(test3 == NULL)
+        simple_err("test3 creation failed.");
+    CU_pTest test4 = CU_add_test(suite1, "test_jump_table", test_jump_table);
+    if(test4 == NULL)
+        simple_err("test4 creation failed.");
+    CU_pTest test5 = CU_add_test(suite1, "test_sieve", test_sieve);
+    if(test5 == NULL)
+        simple_err("test5 creation failed.");
+    CU_pTest test6 = CU_add_test(suite1, "test_range_run", test_range_run);
+    if(test6 == NULL)
+        simple_err("test6 creation failed.");
+    CU_pTest test7 = CU_add_test(suite1, "test_glide_ops", test_glide_ops);
+    if(test7 == NULL)
+        simple_err("test7 creation failed.");
 
     CU_basic_set_mode(CU_BRM_VERBOSE); 
     CU_basic_run_tests();
     CU_cleanup_registry();
 
 #else
-    uintmax_t i;
-    struct info info={1,0};
-    for(i=1; i<TRIES; i++)
+    uintmax_t range_a=0, range_b=0;
+    uintmax_t tries=TRIES;
+    uintmax_t memo_bound=0; // 0 for tries, at most MEMO_BOUND
+    unsigned jump_k=JUMP_K; // 0 for no jumps
+    unsigned sieve_k=0; // 0 for no sieve
+    int threads=1;
+    for(int k=1; k<argc; k++)
     {
-        info=make_info(1,0);
-        collatz(i,&info);
+        if(strncmp(argv[k],"-range=",7)==0)
+        {
+            if(sscanf(argv[k]+7, "%ju,%ju", &range_a, &range_b)!=2)
+                simple_err("Enter -range=A,B to verify A to B-1.");
+        }
+        else if(strncmp(argv[k],"-sieve=",7)==0)
+            sieve_k=(unsigned)atoi(argv[k]+7);
+        else if(strncmp(argv[k],"-threads=",9)==0)
+            threads=atoi(argv[k]+9);
+        else if(strncmp(argv[k],"-tries=",7)==0)
+            tries=strtoumax(argv[k]+7,NULL,10);
+        else if(strncmp(argv[k],"-memo=",6)==0)
+        {
+            memo_bound=strtoumax(argv[k]+6,NULL,10);
+            if(memo_bound < 1)
+                simple_err("memo is at least 1");
+        }
+        else if(strncmp(argv[k],"-jump=",6)==0)
+            jump_k=(unsigned)atoi(argv[k]+6);
+        else
+            simple_err("Arguments are -range=A,B -sieve=K -threads=NUM -tries=NUM -memo=NUM -jump=K");
     }
-    double sum = evens+odds;
-    printf("$$ evens:%f odds:%f\n",(double)evens/sum,(double)odds/sum );
+    if(threads<1 || threads>MAX_THREADS)
+        simple_err("threads out of range");
+    if(tries<2)
+        simple_err("tries is at least 2");
+    if(memo_bound == 0)
+        memo_bound=(tries < MEMO_BOUND ? tries : MEMO_BOUND);
+    static struct range_job job[MAX_THREADS];
+    
+    if(range_b > 0)
+    {
+        struct sieve sv;
+        struct verify_result res;
+        if(sieve_k > 0)
+        {
+            sieve_init(&sv,sieve_k);
+            printf("$$ sieve k:%u survivors:%zu of %ju, records are of survivors only\n", sieve_k, sv.n, (uintmax_t)1<<sieve_k);
+        }
+        range_run(range_a,range_b,threads,NULL,NULL,(sieve_k > 0 ? &sv : NULL),job);
+        res=job[0].res;
+        for(int t=1; t<threads; t++)
+            merge_verify(&res,&job[t].res);
+        if(res.checked == 0)
+            printf("$$ range:[%ju,%ju) checked:0, %s\n", range_a, range_b, (sieve_k > 0 ? "no survivors" : "empty"));
+        else
+        {
+            printf("$$ range:[%ju,%ju) checked:%ju glide:%ju at %ju max:", range_a, range_b, res.checked, res.glide, res.glide_n);
+            print_wide(res.max);
+            printf(" at %ju\n", res.max_n);
+        }
+        if(sieve_k > 0)
+            sieve_free(&sv);
+        printf("Finished.\n");
+        return 0;
+    }
+    
+    struct memo memo;
+    struct jump_table jt;
+    memo_init(&memo,memo_bound);
+    if(jump_k > 0)
+        jump_table_init(&jt,jump_k);
+    range_run(1,tries,threads,&memo,(jump_k > 0 ? &jt : NULL),NULL,job);
+    memo_free(&memo);
+    if(jump_k > 0)
+        jump_table_free(&jt);
+    
+    struct range_job all=job[0];
+    for(int t=1; t<threads; t++)
+    {
+        all.evens+=job[t].evens;
+        all.odds+=job[t].odds;
+        if(job[t].steps > all.steps || (job[t].steps == all.steps && job[t].steps_n < all.steps_n))
+        {
+            all.steps=job[t].steps;
+            all.steps_n=job[t].steps_n;
+        }
+        if(job[t].max_bits > all.max_bits || (job[t].max_bits == all.max_bits && job[t].max > all.max)
+           || (job[t].max_bits == all.max_bits && job[t].max == all.max && job[t].max_n < all.max_n))
+        {
+            all.max=job[t].max;
+            all.max_bits=job[t].max_bits;
+            all.max_n=job[t].max_n;
+        }
+    }
+    double sum = all.evens+all.odds;
+    printf("$$ evens:%f odds:%f\n",(double)all.evens/sum,(double)all.odds/sum );
+    printf("$$ steps:%ju at %ju max:%ju at %ju\n", all.steps, all.steps_n, all.max, all.max_n);
 #endif // NDEBUG
     printf("Finished.\n");
     return 0;
@@ -183,3 +1088,241 @@ void test_collatz(void)
     
 }
 
+void test_collatz_wide(void)
+{
+    struct info info=make_info(1,0);
+    uintmax_t e=evens, o=odds;
+    
+    CU_ASSERT(!collatz(0,&info));
+    
+    CU_ASSERT(collatz(UINT64_C(6148914691236517207),&info)); // 0x5555555555555557, first 3n+1 is past 64 bits
+    CU_ASSERT_EQUAL(info.steps,485);
+    CU_ASSERT_EQUAL(info.max,UINTMAX_MAX);
+    CU_ASSERT_EQUAL(info.max_bits,66);
+    CU_ASSERT_EQUAL(evens-e,321);
+    CU_ASSERT_EQUAL(odds-o,163);
+    
+    info=make_info(1,0);
+    CU_ASSERT(collatz(UINT64_MAX,&info));
+    CU_ASSERT_EQUAL(info.steps,864);
+    CU_ASSERT_EQUAL(info.max_bits,103);
+    
+    info=make_info(1,0);
+    CU_ASSERT(collatz_wide(27,&info));
+    CU_ASSERT_EQUAL(info.max,9232);
+    CU_ASSERT_EQUAL(info.steps,112);
+    CU_ASSERT_EQUAL(info.max_bits,0);
+    
+    info=make_info(1,0);
+    e=evens;
+    o=odds;
+    CU_ASSERT(collatz_big(WIDE_MAX,&info)); // bignum from the first step
+    if(WIDE_BITS==128)
+    {
+        CU_ASSERT_EQUAL(info.steps,1662);
+        CU_ASSERT_EQUAL(info.max_bits,204);
+        CU_ASSERT_EQUAL(evens-e,1068);
+        CU_ASSERT_EQUAL(odds-o,593);
+    }
+}
+
+void test_collatz_memo(void)
+{
+    struct memo memo;
+    memo_init(&memo,1000);
+    
+    for(uintmax_t n=1; n<20000; n++)
+    {
+        struct info info=make_info(1,0);
+        struct info ref=make_info(1,0);
+        uintmax_t e=evens, o=odds;
+        CU_ASSERT(collatz(n,&ref));
+        uintmax_t ref_evens=evens-e, ref_odds=odds-o;
+        e=evens;
+        o=odds;
+        CU_ASSERT(collatz_memo(n,&info,&memo,NULL));
+        CU_ASSERT(info.steps==ref.steps && info.max==ref.max);
+        CU_ASSERT(evens-e==ref_evens && odds-o==ref_odds);
+    }
+    CU_ASSERT_EQUAL(memo.trans[27],111);
+    CU_ASSERT_EQUAL(memo.odd[27],41);
+    CU_ASSERT_EQUAL(memo.max[27],9232);
+    CU_ASSERT_EQUAL(memo.trans[1],0);
+    
+    struct info info=make_info(1,0);
+    CU_ASSERT(collatz_memo(UINT64_C(6148914691236517207),&info,&memo,NULL)); // past 64 bits
+    CU_ASSERT_EQUAL(info.steps,485);
+    CU_ASSERT_EQUAL(info.max_bits,66);
+    CU_ASSERT(!collatz_memo(0,&info,&memo,NULL));
+    
+    memo_free(&memo);
+}
+
+void test_jump_table(void)
+{
+    struct jump_table jt;
+    jump_table_init(&jt,8);
+    
+    CU_ASSERT_EQUAL(jt.entry[0].odd,0); // 256a -> a
+    CU_ASSERT_EQUAL(jt.entry[0].add,0);
+    CU_ASSERT_EQUAL(jt.entry[255].odd,8); // all odd, 256a+255 -> 6561a+6560
+    CU_ASSERT_EQUAL(jt.entry[255].add,6560);
+    CU_ASSERT_EQUAL(jt.entry[255].peak_mul,2*6561);
+    
+    struct memo memo;
+    memo_init(&memo,5000);
+    uintmax_t starts[]={27, 255, 256, 257, 837799, 63728127, UINT64_C(1)<<40, UINT64_C(6148914691236517207)};
+    for(unsigned k=8; k<=20; k+=4)
+    {
+        jump_table_free(&jt);
+        jump_table_init(&jt,k);
+        for(int t=0; t<8; t++)
+        {
+            for(uintmax_t n=starts[t]; n<starts[t]+200; n++)
+            {
+                struct info info=make_info(1,0);
+                struct info ref=make_info(1,0);
+                uintmax_t e=evens, o=odds;
+                CU_ASSERT(collatz(n,&ref));
+                uintmax_t ref_evens=evens-e, ref_odds=odds-o;
+                e=evens;
+                o=odds;
+                CU_ASSERT(collatz_memo(n,&info,(n%2 ? &memo : NULL),&jt));
+                CU_ASSERT(info.steps==ref.steps && info.max==ref.max && info.max_bits==ref.max_bits);
+                CU_ASSERT(evens-e==ref_evens && odds-o==ref_odds);
+            }
+        }
+    }
+    
+    memo_free(&memo);
+    jump_table_free(&jt);
+}
+
+void test_sieve(void)
+{
+    struct sieve sv;
+    size_t counts[]={1, 1, 2, 3, 4, 8, 13, 19, 38, 64}; // residues mod 2^k without stopping time k or less
+    for(unsigned k=1; k<=10; k++)
+    {
+        sieve_init(&sv,k);
+        CU_ASSERT_EQUAL(sv.n,counts[k-1]);
+        sieve_free(&sv);
+    }
+    
+    sieve_init(&sv,2);
+    CU_ASSERT(sv.n==1 && sv.res[0]==3);
+    sieve_free(&sv);
+    
+    struct glide_info g;
+    CU_ASSERT(glide(27,&g));
+    CU_ASSERT_EQUAL(g.steps,96); // 27 stays above itself until 23
+    CU_ASSERT(g.max==9232);
+    CU_ASSERT(glide(1,&g) && g.steps==0);
+    CU_ASSERT(glide(UINT64_C(6148914691236517207),&g)); // past 64 bits
+    CU_ASSERT(g.max > UINTMAX_MAX);
+    
+    struct verify_result all, all_hi, some;
+    verify_range(1,200000,NULL,&all);
+    verify_range(70001,200000,NULL,&all_hi);
+    for(unsigned k=4; k<=16; k+=6)
+    {
+        sieve_init(&sv,k);
+        verify_range(1,200000,&sv,&some);
+        CU_ASSERT(some.checked < all.checked);
+        CU_ASSERT(some.glide==all.glide && some.glide_n==all.glide_n);
+        CU_ASSERT(some.max==all.max && some.max_n==all.max_n);
+        verify_range(70001,200000,&sv,&some); // not at a multiple of 2^k
+        CU_ASSERT(some.glide==all_hi.glide && some.glide_n==all_hi.glide_n);
+        CU_ASSERT(some.max==all_hi.max && some.max_n==all_hi.max_n);
+        if(k == 10)
+            CU_ASSERT(some.checked < all_hi.checked/10);
+        sieve_free(&sv);
+    }
+    CU_ASSERT_EQUAL(all.checked,199999);
+}
+
+void test_range_run(void)
+{
+    static struct range_job job[4];
+    struct memo memo;
+    uintmax_t e=evens, o=odds;
+    
+    for(uintmax_t n=1; n<300000; n++)
+    {
+        struct info info=make_info(1,0);
+        collatz(n,&info);
+    }
+    uintmax_t ref_evens=evens-e, ref_odds=odds-o;
+    
+    struct jump_table jt;
+    jump_table_init(&jt,12);
+    for(int pass=0; pass<2; pass++) // whole memo, then a small memo with jumps above it
+    {
+        memo_init(&memo,(pass == 0 ? 300000 : 5000));
+        range_run(1,300000,4,&memo,(pass == 0 ? NULL : &jt),NULL,job);
+        uintmax_t sum_evens=0, sum_odds=0;
+        bool steps_rec=false, max_rec=false;
+        for(int t=0; t<4; t++)
+        {
+            sum_evens+=job[t].evens;
+            sum_odds+=job[t].odds;
+            steps_rec|=(job[t].steps == 443 && job[t].steps_n == 230631);
+            max_rec|=(job[t].max == UINTMAX_C(24648077896) && job[t].max_n == 270271);
+        }
+        CU_ASSERT(sum_evens == ref_evens && sum_odds == ref_odds);
+        CU_ASSERT(steps_rec);
+        CU_ASSERT(max_rec);
+        memo_free(&memo);
+    }
+    jump_table_free(&jt);
+    
+    struct sieve sv;
+    struct verify_result ref, res;
+    sieve_init(&sv,12);
+    verify_range(5000,900000,&sv,&ref);
+    range_run(5000,900000,3,NULL,NULL,&sv,job);
+    res=job[0].res;
+    for(int t=1; t<3; t++)
+        merge_verify(&res,&job[t].res);
+    CU_ASSERT(res.checked == ref.checked);
+    CU_ASSERT(res.glide == ref.glide && res.glide_n == ref.glide_n);
+    CU_ASSERT(res.max == ref.max && res.max_n == ref.max_n);
+    sieve_free(&sv);
+}
+
+void test_glide_ops(void)
+{
+    struct glide_ops best=glide_ops;
+    struct glide_ops scalar={batch_scalar, "scalar"};
+    struct verify_result ref, res;
+    struct sieve sv;
+    sieve_init(&sv,10);
+    
+    uintmax_t from[]={1, 1000, UINTMAX_C(1)<<40, UINT64_C(6148914691236517000)}; // last ones pass 64 bits
+    for(int f=0; f<4; f++)
+    {
+        for(int use_sieve=0; use_sieve<2; use_sieve++)
+        {
+            glide_ops=scalar;
+            verify_range(from[f],from[f]+5000,(use_sieve ? &sv : NULL),&ref);
+            glide_ops=best;
+            verify_range(from[f],from[f]+5000,(use_sieve ? &sv : NULL),&res);
+            CU_ASSERT(res.checked == ref.checked);
+            CU_ASSERT(res.glide == ref.glide && res.glide_n == ref.glide_n);
+            CU_ASSERT(res.max == ref.max && res.max_n == ref.max_n);
+        }
+    }
+    
+    uintmax_t num[]={27, 2, 1, 0, 27, 63728127, 3};
+    glide_ops=scalar;
+    ref=(struct verify_result){.checked=0, .glide=0, .glide_n=0, .max=0, .max_n=0};
+    glide_ops.batch(num,7,&ref);
+    glide_ops=best;
+    res=(struct verify_result){.checked=0, .glide=0, .glide_n=0, .max=0, .max_n=0};
+    glide_ops.batch(num,7,&res);
+    CU_ASSERT(res.checked == 7 && ref.checked == 7);
+    CU_ASSERT(res.glide == 613 && res.glide_n == 63728127);
+    CU_ASSERT(res.max == ref.max && res.max_n == ref.max_n);
+    
+    sieve_free(&sv);
+}
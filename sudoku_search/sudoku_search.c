@@ -2,6 +2,8 @@
 
 // Sudoku constraint satisfaction and search solver.
 
+#define _POSIX_C_SOURCE 200809L // truncate, fsync
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
@@ -12,13 +14,25 @@
 #include <stddef.h>
 #include <time.h>
 #include <assert.h>
+#include <stdalign.h>
+#include <unistd.h>
+#ifdef TEST
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#endif // TEST
 
 const static char VERSION[] = "3.0";
 const static double RUN_TIME = 30.0;// roughly runs for this time, in seconds
 const static unsigned N_MAX = 1000; // Number of tries for each sudoku puzzle
+const static unsigned RESTART_UNIT = 32; // nodes per restart unit
+const static double RESTART_FACTOR = 1.5; // growth of geometric restarts
+const static unsigned CKPT_EVERY = 100; // puzzles between checkpoints with -resume
 
 #define BLOCK_SIZE 3
 #define GRID_SIZE (BLOCK_SIZE*BLOCK_SIZE)
+#define N_CELLS (GRID_SIZE*GRID_SIZE)
+#define IDX(row,column) ((row)*GRID_SIZE+(column))
+#define CACHE_LINE 64
 #define UNUSED(x) (void)(x)
 
 const static char input_sep='/';
@@ -27,6 +41,17 @@ const static char output_sep='$';
 #define PRE_ALLOC 100
 #define ALLOC_FACTOR 10000
 
+#define BATCH_LANES 16 // puzzles propagated in lockstep
+#define NOGOOD_MAX 1024 // learned nogoods kept for each puzzle
+#define NOGOOD_LEN 8 // longer conflicts are not stored
+#define PEERS 20
+#define STREAM_BUFF (1<<16) // bytes read at once by verify
+#define CH_SEP 0x8000 // char codes of grid_stream, cells are value masks
+#define CH_BAD 0x4000
+
+#define BENCH_NODES 1000 // states in node microbenchmark
+#define BENCH_ROUNDS 2
+
 #define BUFF_SIZE 256
 #define INFO_BUFF_SIZE 64
 #define fatal_err(...) \
@@ -60,43 +85,157 @@ const static uint16_t MAX_HASH=(GRID_SIZE*GRID_SIZE);
 const unsigned ONE = 1;
 const unsigned NINE = 1<<(GRID_SIZE-1);
 
-struct sudoku_state
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HW_BITOPS // POPCNT and TZCNT selected at run time
+#endif
+
+struct bit_ops
+{
+    uint8_t (*popcnt)(uint32_t);
+    unsigned (*ctz)(uint32_t); // v is not 0
+    char const *name;
+};
+
+static uint8_t popcnt_tab[1<<8];
+static uint8_t ctz_tab[1<<8];
+
+struct ss_header
 {
     uint16_t min_hash;
     uint16_t hash; // sum of bounded cells
     bool contra; // contradiction on this sudoku state
-    uint16_t cell[GRID_SIZE][GRID_SIZE];
+    int16_t parent; // slot of parent state
+    uint8_t depth; // decisions from root
+    uint8_t decision_cell; // decision which made this state from parent
+    uint16_t decision_value;
+};
 
-    // Padding if required
+struct sudoku_state // flat cells first, header in padding of last cache line
+{
+    alignas(CACHE_LINE) uint16_t cell[N_CELLS]; // row major
+    struct ss_header head;
 };
 typedef struct sudoku_state ss_t;
 
+static_assert(sizeof(ss_t)%CACHE_LINE==0, "ss_t is not padded to whole cache lines");
+static_assert(sizeof(ss_t)==3*CACHE_LINE, "ss_t header does not fit in last cache line");
+
+enum restart_policy
+{
+    RESTART_NONE, // deterministic depth first search
+    RESTART_LUBY,
+    RESTART_GEOMETRIC
+};
+
+struct restart_info
+{
+    enum restart_policy policy;
+    unsigned seed;
+    unsigned run; // number of current run, from 1
+    size_t limit; // nodes allowed in current run
+    size_t max_limit; // nmax-1, set by main, so a run restarts before n reaches nmax
+    ss_t best; // root state after propagation, kept between runs
+};
+
+static struct restart_info restart = {.policy=RESTART_NONE, .seed=1, .run=1, .limit=0, .max_limit=0};
+
+struct literal // cell has value
+{
+    uint8_t cell;
+    uint16_t value;
+};
+
+struct nogood // literals which can not all hold
+{
+    uint8_t len;
+    struct literal lit[NOGOOD_LEN];
+};
+
+struct nogood_store // bounded, oldest nogood is replaced first
+{
+    struct nogood ng[NOGOOD_MAX];
+    size_t count;
+    size_t next;
+};
+
+static struct nogood_store nogoods = {.count=0, .next=0};
+static uint8_t peers[N_CELLS][PEERS]; // cells in same row, column or region, ascending
+
+struct checkpoint_info
+{
+    unsigned every; // puzzles between checkpoints, 0 for none
+    bool resume;
+    int count; // puzzles solved at last checkpoint
+    char name[LINE_LEN];
+};
+
+static struct checkpoint_info checkpoint = {.every=0, .resume=false, .count=0, .name={'\0'}};
+static long file_pos=0; // input position of next puzzle
+static FILE *out_file=NULL; // output of solved grids, open for the whole run
+
+struct sudoku_batch // structure of arrays, one lane per puzzle
+{
+    alignas(32) uint16_t cell[GRID_SIZE*GRID_SIZE][BATCH_LANES];
+    size_t lanes; // lanes in use
+};
+
+struct grid_stream // buffered reader of separated grids
+{
+    FILE *file;
+    char const *name;
+    size_t grids; // grids read
+    size_t bytes; // bytes read
+    size_t len;
+    size_t pos;
+    uint16_t code[1<<8]; // 0 for white space, value mask for cell
+    char buff[STREAM_BUFF];
+};
+
 uint16_t nine_possible(void);
 void compute_hash(ss_t *ss);
 bool no_contradiction(ss_t *ss);
 void compute_contra(ss_t *ss);
+bool find_contra(ss_t const *const ss_ptr);
 
 bool is_single_value(uint16_t );
-bool sudoku_states_equal(ss_t, ss_t);
+bool sudoku_states_equal(ss_t const *const, ss_t const *const);
 bool sudoku_is_solved_hashwise(ss_t * ss_ptr);
 
 void zero_minhash(ss_t * ss_ptr);
-ss_t get_ss(char const * const input, char const * const output, int count, time_t begin);
+bool get_ss(char const * const input, ss_t *const ss_ptr);
 
-void fprint_ss(FILE *of, ss_t ss);
+void fprint_ss(FILE *of, ss_t const *const ss_ptr);
 unsigned count_zero_bits_on_right(uint32_t);
 
 bool row_column_region(uint8_t,uint8_t,uint8_t,uint8_t);
 bool in_region(uint8_t,uint8_t,uint8_t,uint8_t );
 bool in_range(uint8_t v,uint8_t min, uint8_t max);
 
-noreturn void solve(char const * const ip, char const * const op,double const rt, unsigned nmax);
+noreturn void solve(char const * const ip, char const * const op,double const rt, unsigned nmax, size_t lanes);
+void solve_one(ss_t *const ss_ptr, char const * const op, unsigned nmax);
 void check_time(time_t time_beg,double rt_input);
+bool time_over(time_t time_beg,double rt_input);
+void save_checkpoint(char const * const op, int count);
+int load_checkpoint(char const * const op);
 void update_3(ss_t *const root_ptr, ss_t *const ss1_ptr,ss_t *const ss2_ptr);
 
-void solve_info(int row, int column,size_t n1,size_t n2);
-
-bool is_unsolvable(ss_t);
+size_t get_batch(struct grid_stream *const stream_ptr, struct sudoku_batch *const batch_ptr, size_t lanes);
+void propagate_batch(struct sudoku_batch *const batch_ptr);
+uint16_t batch_naked(struct sudoku_batch *const batch_ptr);
+uint16_t batch_hidden(struct sudoku_batch *const batch_ptr);
+bool batch_solved(struct sudoku_batch const *const batch_ptr, size_t lane);
+void batch_to_ss(struct sudoku_batch const *const batch_ptr, size_t lane, ss_t *const ss_ptr);
+uint8_t unit_cell(int unit, int k);
+
+noreturn void verify(char const * const ip, char const * const op);
+void stream_open(struct grid_stream *const stream_ptr, char const * const name, char sep, bool clues);
+bool stream_fill(struct grid_stream *const stream_ptr);
+bool next_grid(struct grid_stream *const stream_ptr, struct sudoku_batch *const batch_ptr, size_t lane);
+void stream_seek(struct grid_stream *const stream_ptr, long pos);
+long stream_tell(struct grid_stream const *const stream_ptr);
+void verify_batch(struct sudoku_batch const *const grid_ptr, struct sudoku_batch const *const clue_ptr, bool *const bad);
+
+bool is_unsolvable(ss_t const *const);
 uint16_t eliminate_single_value(uint16_t,uint16_t);
 void naked_cell(ss_t * ss_ptr);
 void hidden_row(ss_t * ss_ptr);
@@ -109,6 +248,14 @@ void update_hashes(ss_t * const ss_ptr);
 
 ss_t *fill_cells(ss_t *, size_t,bool, char const * const op, unsigned nmax);
 ss_t * go_back(ss_t *root_ptr,ss_t * end_ptr);
+size_t decision_path(ss_t *root_ptr, ss_t *dead_ptr, ss_t **path, struct literal *lits);
+size_t analyse_conflict(ss_t const *root_ptr, struct literal const *lits, size_t k, bool *keep);
+bool literals_fail(ss_t const *root_ptr, struct literal const *lits, bool const *keep, size_t k);
+void propagate(ss_t *const ss_ptr);
+void nogood_add(struct literal const *lits, bool const *keep, size_t k);
+void nogood_prune(ss_t *const ss_ptr);
+void nogood_clear(void);
+void peers_init(void);
 void print_solved(ss_t const *const end_ptr, char const *const op, size_t n);
 void print_contra (ss_t const *const end_ptr, bool contra, bool pre_contra );
 uint16_t first_multi_value_cell(ss_t const*const current_ptr, int *row_ptr, int *column_ptr);
@@ -116,19 +263,39 @@ void print_4_cells(uint16_t root_cell, uint16_t current_cell,uint16_t cell, uint
 
 uint16_t next_cell(uint16_t cell);
 uint8_t try_next(uint16_t cell);
+uint16_t select_cell(ss_t const*const current_ptr, int *row_ptr, int *column_ptr);
+uint16_t select_value(uint16_t cell);
+
+size_t luby(unsigned i);
+size_t restart_limit(unsigned run);
+void restart_init(ss_t const *const root_ptr);
+bool restart_due(size_t n);
+void restart_search(ss_t *const root_ptr);
+enum restart_policy get_policy(char const *const name);
 
 void update(ss_t * const, ss_t * const);
 
-bool has_contra (ss_t ss);
-bool no_solution(ss_t ss);
+bool has_contra (ss_t const *const ss_ptr);
+bool no_solution(ss_t const *const ss_ptr);
 
 noreturn void fatal_err_callee(const char * const);
 void print_info_callee(const char * const s);
 
 void *my_alloc(size_t );
+ss_t *alloc_states(size_t n);
 
 uint8_t popcnt(uint32_t v);
-void first_uneq_cell(const ss_t current_ptr,const ss_t end_ptr,int *const row,int *const column);
+uint8_t popcnt_table(uint32_t v);
+unsigned ctz_table(uint32_t v);
+#ifdef HW_BITOPS
+uint8_t popcnt_hw(uint32_t v);
+unsigned ctz_hw(uint32_t v);
+#endif // HW_BITOPS
+void bitops_init(void);
+void bench_bitops(void);
+
+static struct bit_ops bit_ops = {.popcnt=popcnt_table, .ctz=ctz_table, .name="table"};
+void first_uneq_cell(ss_t const *const current_ptr, ss_t const *const end_ptr, int *const row, int *const column);
 
 bool is_repeated(ss_t *const root_ptr,ss_t *const end_ptr);
 
@@ -140,6 +307,12 @@ void print_cell_callee(const char* const cell_name,uint16_t cell);
 noreturn void print_version(void);
 noreturn void print_help(void);
 char* get_arg(char const*const arg_str, char *beg_str);
+void bench_node(char const * const input);
+void bench_batch(char const * const input);
+#ifdef TEST
+void run_tests(void);
+void test_restart_limit(void);
+#endif // TEST
 
 int main(int argc, char *argv[])
 {
@@ -154,6 +327,16 @@ int main(int argc, char *argv[])
     char *t_ptr;
     unsigned nmax=N_MAX;
     char *n_ptr;
+    char *r_ptr;
+    char *s_ptr;
+    size_t lanes=0;
+    char *b_ptr;
+    char *c_ptr;
+    bool verify_only=false;
+    bool input_given=false;
+
+    bitops_init();
+    peers_init();
     
     for(i=1; i<argc; i++)
     {
@@ -161,10 +344,17 @@ int main(int argc, char *argv[])
             print_help();
         else if(strcmp(argv[i], "-v")==0)
             print_version();
+        else if(strcmp(argv[i], "-resume")==0)
+            checkpoint.resume=true;
+        else if(strcmp(argv[i], "-verify")==0)
+            verify_only=true;
 
         i_ptr=get_arg(argv[i], "-inputf=");
         if(i_ptr!=NULL)
+        {
             strncpy(inputf_name, i_ptr, LINE_LEN-1);
+            input_given=true;
+        }
 
         o_ptr=get_arg(argv[i], "-outputf=");
         if(o_ptr!=NULL)
@@ -185,9 +375,52 @@ int main(int argc, char *argv[])
             nmax=(unsigned)strtoul(n_ptr, NULL, 10);
             printf("nmax is %u\n",nmax);
         }
+
+        r_ptr=get_arg(argv[i], "-restart=");
+        if(r_ptr!=NULL)
+            restart.policy=get_policy(r_ptr);
+
+        s_ptr=get_arg(argv[i], "-seed=");
+        if(s_ptr!=NULL)
+            restart.seed=(unsigned)strtoul(s_ptr, NULL, 10);
+
+        b_ptr=get_arg(argv[i], "-batch=");
+        if(b_ptr!=NULL)
+        {
+            lanes=(size_t)strtoul(b_ptr, NULL, 10);
+            if(lanes>BATCH_LANES)
+                fatal_err("batch is %zu, at most %d puzzles are allowed", lanes, BATCH_LANES);
+        }
+
+        c_ptr=get_arg(argv[i], "-ckpt=");
+        if(c_ptr!=NULL)
+            checkpoint.every=(unsigned)strtoul(c_ptr, NULL, 10);
     }
 
-    solve(inputf_name, outputf_name, rt_input, nmax);
+    if(nmax<2)
+        fatal_err("nmax is %u, at least 2 states are needed", nmax);
+    restart.max_limit=nmax-1;
+
+#ifdef TEST
+    run_tests();
+    return EXIT_SUCCESS;
+#endif // TEST
+
+    if(checkpoint.resume && checkpoint.every==0)
+        checkpoint.every=CKPT_EVERY;
+    snprintf(checkpoint.name, sizeof(checkpoint.name), "%s.ckpt", outputf_name);
+
+    if(verify_only)
+        verify(input_given ? inputf_name : NULL, outputf_name);
+
+    srand(restart.seed);
+#ifdef BENCH
+    bench_bitops();
+    bench_node(inputf_name);
+    bench_batch(inputf_name);
+    return EXIT_SUCCESS;
+#endif // BENCH
+    solve(inputf_name, outputf_name, rt_input, nmax, lanes);
 
     return EXIT_SUCCESS;
 }
@@ -224,211 +457,1021 @@ noreturn void print_help(void)
     printf("Enter -inputf=NAME.EXT to override default values.\n");
     printf("Enter -outputf=NAME.EXT to override default values.\n");
     printf("Enter -time=SECONDS to set the rough max execution time.\n");
-    printf("Enter -nmax=NUM to set the max states for each Sudoku puzzle.");
+    printf("Enter -nmax=NUM to set the max states for each Sudoku puzzle.\n");
+    printf("Enter -restart=none|luby|geometric to set the restart policy of search.\n");
+    printf("Enter -seed=NUM to set the random seed used with restarts.\n");
+    printf("Enter -batch=NUM to propagate up to %d puzzles in lockstep.\n", BATCH_LANES);
+    printf("Enter -ckpt=NUM to save a checkpoint every NUM puzzles to OUTPUTF.ckpt file.\n");
+    printf("Enter -resume to continue from the last checkpoint.\n");
+    printf("Enter -verify to check the grids of output file, against clues of input file if -inputf is given.");
     exit (EXIT_SUCCESS);
 }
 //////////////////////////////////////////////
 
-void check_time(time_t time_beg, double rt)
-{
-    time_t time_end;
-    time(&time_end);
-    double dt = difftime( time_end, time_beg );
+void bench_bitops(void)
+{
+    struct bit_ops const ops[]={{popcnt_table, ctz_table, "table"},
+#ifdef HW_BITOPS
+        {popcnt_hw, ctz_hw, "hardware"},
+#endif // HW_BITOPS
+    };
+    size_t k;
+    unsigned round;
+    uint16_t v;
+    unsigned sum=0;
+    clock_t beg;
+    unsigned const calls=BENCH_ROUNDS*BENCH_NODES*((1u<<GRID_SIZE)-1);
+
+    for(k=0; k<sizeof(ops)/sizeof(ops[0]); k++)
+    {
+        beg=clock();
+        for(round=0; round<BENCH_ROUNDS*BENCH_NODES; round++)
+            for(v=1; v<=nine_possible(); v++)
+                sum+=ops[k].popcnt(v);
+        printf("popcnt %s: %.2f ns per call\n", ops[k].name,
+               1e9*(double)(clock()-beg)/CLOCKS_PER_SEC/calls);
+
+        beg=clock();
+        for(round=0; round<BENCH_ROUNDS*BENCH_NODES; round++)
+            for(v=1; v<=nine_possible(); v++)
+                sum+=ops[k].ctz(v);
+        printf("ctz %s: %.2f ns per call\n", ops[k].name,
+               1e9*(double)(clock()-beg)/CLOCKS_PER_SEC/calls);
+    }
+
+    beg=clock();
+    for(round=0; round<BENCH_ROUNDS*BENCH_NODES; round++)
+        for(v=1; v<=nine_possible(); v++)
+            sum+=is_single_value(v);
+    printf("is_single_value: %.2f ns per call\n",
+           1e9*(double)(clock()-beg)/CLOCKS_PER_SEC/calls);
+
+    printf("sum %u\n", sum); // keeps the calls alive
+}
+
+void bench_node(char const * const input) // per node cost of state copy, checks and constraints
+{
+    ss_t *states_ptr=alloc_states(BENCH_NODES+1);
+    ss_t ss;
+    clock_t beg;
+    size_t k;
+    unsigned round;
+    unsigned hits=0;
+    int row=0;
+    int column=0;
+
+    if(!get_ss(input, &ss))
+        fatal_err("No puzzle in %s", input);
+    states_ptr[0]=ss;
+    update(states_ptr, states_ptr);
+
+    beg=clock();
+    for(round=0; round<BENCH_ROUNDS; round++)
+        for(k=1; k<=BENCH_NODES; k++)
+        {
+            hits+=is_unsolvable(&states_ptr[0]);
+            hits+=has_contra(&states_ptr[0]);
+            hits+=no_solution(&states_ptr[0]);
+            hits+=sudoku_states_equal(&states_ptr[0], &states_ptr[0]);
+            first_uneq_cell(&states_ptr[0], &states_ptr[0], &row, &column);
+        }
+    printf("state checks: %.1f ns per node\n",
+           1e9*(double)(clock()-beg)/CLOCKS_PER_SEC/(BENCH_ROUNDS*BENCH_NODES));
+
+    beg=clock();
+    for(round=0; round<BENCH_ROUNDS; round++)
+        for(k=1; k<=BENCH_NODES; k++)
+        {
+            states_ptr[k]=states_ptr[k-1];
+            update(states_ptr, &states_ptr[k]);
+            hits+=no_solution(&states_ptr[k]);
+            hits+=sudoku_states_equal(&states_ptr[k-1], &states_ptr[k]);
+        }
+    printf("full node: %.1f ns per node\n",
+           1e9*(double)(clock()-beg)/CLOCKS_PER_SEC/(BENCH_ROUNDS*BENCH_NODES));
+
+    printf("hits %u\n", hits); // keeps the calls alive
+    free(states_ptr);
+}
+
+void bench_batch(char const * const input) // puzzles per second of buffered parse and lockstep propagation
+{
+    static struct grid_stream stream;
+    static struct sudoku_batch batch;
+    size_t got;
+    size_t lane;
+    size_t puzzles=0;
+    size_t solved=0;
+    unsigned round;
+    clock_t beg;
+    double sec;
+
+    stream_open(&stream, input, input_sep, true);
+    beg=clock();
+    for(round=0; round<BENCH_ROUNDS*BENCH_NODES; round++)
+    {
+        stream_seek(&stream, 0);
+        do
+        {
+            got=get_batch(&stream, &batch, BATCH_LANES);
+            propagate_batch(&batch);
+            for(lane=0; lane<got; lane++)
+                solved+=batch_solved(&batch, lane);
+            puzzles+=got;
+        }
+        while(got==BATCH_LANES);
+    }
+    sec=(double)(clock()-beg)/CLOCKS_PER_SEC;
+    printf("batch: %.0f puzzles/s, %zu of %zu solved by propagation\n",
+           sec>0 ? (double)puzzles/sec : 0.0, solved, puzzles);
+
+    fclose(stream.file);
+    file_pos=0;
+}
+
+void check_time(time_t time_beg, double rt)
+{
+    time_t time_end;
+    time(&time_end);
+    double dt = difftime( time_end, time_beg );
+
+    if(dt >= rt)
+        fatal_err("time is over, time passed %f seconds",dt);
+}
+
+bool time_over(time_t time_beg, double rt)
+{
+    time_t time_end;
+    time(&time_end);
+
+    return difftime( time_end, time_beg ) >= rt;
+}
+
+void save_checkpoint(char const * const output, int count) // input position, puzzle count, output position
+{
+    char tmp_name[LINE_LEN+8];
+    long output_pos;
+
+    if(fflush(out_file)!=0 || fsync(fileno(out_file))!=0) // grids are on disk before the checkpoint names them
+        fatal_err("Writing output file %s failed.", output);
+    output_pos=ftell(out_file);
+
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", checkpoint.name);
+    FILE* ckpt_file=fopen(tmp_name, "wt");
+    if(ckpt_file==NULL)
+        fatal_err("Can not open checkpoint file %s", tmp_name);
+    fprintf(ckpt_file, "%ld %d %ld\n", file_pos, count, output_pos);
+    if(fflush(ckpt_file)!=0 || fsync(fileno(ckpt_file))!=0 || fclose(ckpt_file)!=0)
+        fatal_err("Writing checkpoint file %s failed.", tmp_name);
+
+    if(rename(tmp_name, checkpoint.name)!=0) // atomic replace
+        fatal_err("Renaming %s failed.", tmp_name);
+
+    checkpoint.count=count;
+    print_info("$ checkpoint, count is %d\n", count);
+}
+
+int load_checkpoint(char const * const output)
+{
+    long input_pos;
+    int count;
+    long output_pos;
+
+    FILE* ckpt_file=fopen(checkpoint.name, "rt");
+    if(ckpt_file==NULL)
+        fatal_err("Can not open checkpoint file %s", checkpoint.name);
+    if(fscanf(ckpt_file, "%ld %d %ld", &input_pos, &count, &output_pos)!=3)
+        fatal_err("Wrong checkpoint file %s", checkpoint.name);
+    fclose(ckpt_file);
+
+    if(truncate(output, (off_t)output_pos)!=0) // drop grids after checkpoint
+        fatal_err("Can not truncate output file %s", output);
+
+    file_pos=input_pos;
+    checkpoint.count=count;
+    printf("Resuming from puzzle %d\n", count);
+
+    return count;
+}
+
+void update_3(ss_t *const root_ptr, ss_t *const ss1_ptr,ss_t *const ss2_ptr)
+{
+    implement_constraints(ss1_ptr);
+    *ss2_ptr=*ss1_ptr;
+
+    update_hashes(ss2_ptr);
+
+    if(is_unsolvable(ss2_ptr))
+        fatal_err("Problem is unsolvable after implementing constraints.");
+
+    *root_ptr=*ss2_ptr;
+    root_ptr->head.parent=0;
+    root_ptr->head.depth=0;
+    restart_init(root_ptr);
+    return;
+}
+
+noreturn void solve(char const * const input, char const * const output, double const rt_input, unsigned nmax, size_t lanes)
+{
+    time_t time_beg;
+    time(&time_beg);
+
+    ss_t ss;
+    int count = 0;
+    size_t lane;
+    size_t got;
+    static struct sudoku_batch batch;
+    static struct grid_stream in_stream;
+
+    if(checkpoint.resume)
+    {
+        count=load_checkpoint(output);
+        out_file=fopen(output, "at");
+        if(out_file==NULL)
+            fatal_err("Can not open output file %s", output);
+    }
+    else
+    {
+        out_file=fopen(output, "wt");
+        if(out_file==NULL)
+            fatal_err("Initially can not open output file %s", output);
+        fprintf(out_file, "%c\n", output_sep);
+    }
+
+    if(lanes>0) // input is read once through a buffer
+    {
+        stream_open(&in_stream, input, input_sep, true);
+        stream_seek(&in_stream, file_pos);
+    }
+    else
+    {
+        FILE* input_file=fopen(input, "rt");
+        if(input_file==NULL)
+            fatal_err("failed to open %s",input);
+        fclose(input_file);
+    }
+
+    do
+    {
+        if(checkpoint.every>0 && (count-checkpoint.count>=(int)checkpoint.every || time_over(time_beg, rt_input)))
+            save_checkpoint(output, count);
+        check_time(time_beg, rt_input);
+
+        if(lanes==0)
+        {
+            if(!get_ss(input, &ss))
+                print_finish(input, output, count, time_beg);
+            count++;
+
+            solve_one(&ss, output, nmax);
+            continue;
+        }
+
+        got=get_batch(&in_stream, &batch, lanes);
+        propagate_batch(&batch);
+
+        for(lane=0; lane<got; lane++)
+        {
+            count++;
+            batch_to_ss(&batch, lane, &ss);
+            if(batch_solved(&batch, lane))
+            {
+                print_info("Problem is solved in batch, lane is %zu\n", lane);
+                print_solved(&ss, output, 1);
+            }
+            else
+                solve_one(&ss, output, nmax);
+        }
+
+        if(got<lanes)
+            print_finish(input, output, count, time_beg);
+    }
+    while(true);
+}
+
+void solve_one(ss_t *const ss_ptr, char const * const output, unsigned nmax)
+{
+    ss_t ss2;
+    ss_t *root_ptr;
+    ss_t *end_ptr;
+    size_t n=1;
+
+    root_ptr=alloc_states(ALLOC_FACTOR);
+    nogood_clear();
+
+    if(is_unsolvable(ss_ptr))
+        fatal_err("Problem is unsolvable initially.");
+    if(has_contra(ss_ptr))
+        fatal_err("Problem has contradiction initially.");
+
+    update_3(root_ptr,ss_ptr,&ss2);
+
+    print_info("// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ //\n");
+    if(sudoku_is_solved_hashwise(&ss2))
+    {
+        printf("Problem is solved after implementing constraints.\n");
+        print_solved(&ss2, output, n);
+        free(root_ptr);
+        return;
+    }
+
+    end_ptr=fill_cells(root_ptr, n, false, output, nmax);
+    if(end_ptr==NULL)
+        fatal_err("end_ptr returned from fill_cells is NULL");
+
+    if(!sudoku_is_solved_hashwise(end_ptr))
+        fatal_err("Problem is not solved after filling.");
+
+    printf("Problem is solved after filling.\n");
+    free(root_ptr);
+}
+
+uint8_t unit_cell(int unit, int k) // units are 9 rows, 9 columns then 9 regions
+{
+    int row;
+    int column;
+
+    if(unit<GRID_SIZE)
+    {
+        row=unit;
+        column=k;
+    }
+    else if(unit<2*GRID_SIZE)
+    {
+        row=k;
+        column=unit-GRID_SIZE;
+    }
+    else
+    {
+        unit-=2*GRID_SIZE;
+        row=unit/BLOCK_SIZE*BLOCK_SIZE + k/BLOCK_SIZE;
+        column=unit%BLOCK_SIZE*BLOCK_SIZE + k%BLOCK_SIZE;
+    }
+
+    return (uint8_t)(row*GRID_SIZE+column);
+}
+
+size_t get_batch(struct grid_stream *const stream_ptr, struct sudoku_batch *const batch_ptr, size_t lanes)
+{
+    size_t lane;
+
+    memset(batch_ptr, 0, sizeof(*batch_ptr));
+    for(lane=0; lane<lanes; lane++)
+        if(!next_grid(stream_ptr, batch_ptr, lane))
+            break;
+    batch_ptr->lanes=lane;
+    file_pos=stream_tell(stream_ptr);
+
+    return lane;
+}
+
+void propagate_batch(struct sudoku_batch *const batch_ptr)
+{
+    uint16_t changed;
+    unsigned pass=0;
+
+    do // to a fixed point for all lanes
+    {
+        changed=batch_naked(batch_ptr);
+        changed|=batch_hidden(batch_ptr);
+        pass++;
+    }
+    while(changed && pass<GRID_SIZE*GRID_SIZE);
+}
+
+uint16_t batch_naked(struct sudoku_batch *const batch_ptr)
+{
+    alignas(32) uint16_t seen[3*GRID_SIZE][BATCH_LANES];
+    uint16_t changed=0;
+    int unit;
+    int k;
+    int i;
+    size_t l;
+
+    for(unit=0; unit<3*GRID_SIZE; unit++)
+    {
+        for(l=0; l<BATCH_LANES; l++)
+            seen[unit][l]=0;
+        for(k=0; k<GRID_SIZE; k++)
+        {
+            uint16_t const *const c=batch_ptr->cell[unit_cell(unit,k)];
+            for(l=0; l<BATCH_LANES; l++) // lanes are vectorized
+                seen[unit][l] |= (c[l] & (c[l]-1))==0 ? c[l] : 0;
+        }
+    }
+
+    for(i=0; i<GRID_SIZE*GRID_SIZE; i++)
+    {
+        int row=i/GRID_SIZE;
+        int column=i%GRID_SIZE;
+        int region=row/BLOCK_SIZE*BLOCK_SIZE + column/BLOCK_SIZE;
+        uint16_t *const c=batch_ptr->cell[i];
+        for(l=0; l<BATCH_LANES; l++)
+        {
+            uint16_t elim=seen[row][l] | seen[GRID_SIZE+column][l] | seen[2*GRID_SIZE+region][l];
+            uint16_t nc=(c[l] & (c[l]-1))==0 ? c[l] : (uint16_t)(c[l] & ~elim);
+            changed |= c[l]^nc;
+            c[l]=nc;
+        }
+    }
+
+    return changed;
+}
+
+uint16_t batch_hidden(struct sudoku_batch *const batch_ptr) // rows and columns, as hidden_row and hidden_column
+{
+    alignas(32) uint16_t once[BATCH_LANES];
+    alignas(32) uint16_t twice[BATCH_LANES];
+    uint16_t changed=0;
+    int unit;
+    int k;
+    size_t l;
+
+    for(unit=0; unit<2*GRID_SIZE; unit++)
+    {
+        for(l=0; l<BATCH_LANES; l++)
+        {
+            once[l]=0;
+            twice[l]=0;
+        }
+        for(k=0; k<GRID_SIZE; k++)
+        {
+            uint16_t const *const c=batch_ptr->cell[unit_cell(unit,k)];
+            for(l=0; l<BATCH_LANES; l++)
+            {
+                twice[l] |= once[l] & c[l];
+                once[l] |= c[l];
+            }
+        }
+        for(k=0; k<GRID_SIZE; k++)
+        {
+            uint16_t *const c=batch_ptr->cell[unit_cell(unit,k)];
+            for(l=0; l<BATCH_LANES; l++)
+            {
+                uint16_t missing=(uint16_t)(c[l] & once[l] & ~twice[l]);
+                bool sv=missing!=0 && (missing & (missing-1))==0;
+                uint16_t nc=sv ? missing : c[l];
+                changed |= c[l]^nc;
+                c[l]=nc;
+            }
+        }
+    }
+
+    return changed;
+}
+
+bool batch_solved(struct sudoku_batch const *const batch_ptr, size_t lane)
+{
+    int unit;
+    int k;
+
+    for(unit=0; unit<3*GRID_SIZE; unit++)
+    {
+        uint16_t all=0;
+        for(k=0; k<GRID_SIZE; k++)
+        {
+            uint16_t c=batch_ptr->cell[unit_cell(unit,k)][lane];
+            if(!is_single_value(c))
+                return false;
+            all|=c;
+        }
+        if(all!=nine_possible())
+            return false;
+    }
+
+    return true;
+}
+
+void batch_to_ss(struct sudoku_batch const *const batch_ptr, size_t lane, ss_t *const ss_ptr)
+{
+    int row;
+    int column;
+
+    memset(ss_ptr, 0, sizeof(*ss_ptr));
+    for(row=0; row<GRID_SIZE; row++)
+        for(column=0; column<GRID_SIZE; column++)
+            ss_ptr->cell[IDX(row,column)]=batch_ptr->cell[row*GRID_SIZE+column][lane];
+    compute_hash(ss_ptr);
+}
+
+noreturn void verify(char const * const input, char const * const output)
+{
+    static struct grid_stream out_stream;
+    static struct grid_stream in_stream;
+    static struct sudoku_batch grids;
+    static struct sudoku_batch clues;
+    bool bad[BATCH_LANES];
+    size_t lane;
+    size_t n_bad=0;
+    int cell;
+    clock_t beg=clock();
+
+    stream_open(&out_stream, output, output_sep, false);
+    if(input!=NULL)
+        stream_open(&in_stream, input, input_sep, true);
+    else
+        for(cell=0; cell<N_CELLS; cell++)
+            for(lane=0; lane<BATCH_LANES; lane++)
+                clues.cell[cell][lane]=nine_possible();
+
+    do
+    {
+        for(lane=0; lane<BATCH_LANES; lane++)
+        {
+            if(!next_grid(&out_stream, &grids, lane))
+                break;
+            if(input!=NULL && !next_grid(&in_stream, &clues, lane))
+                fatal_err("Input file %s has fewer puzzles than output file %s", input, output);
+        }
+        grids.lanes=lane;
+
+        verify_batch(&grids, &clues, bad);
+        for(lane=0; lane<grids.lanes; lane++)
+            if(bad[lane])
+            {
+                n_bad++;
+                printf("Grid %zu is not a valid solution.\n", out_stream.grids-grids.lanes+lane+1);
+            }
+    }
+    while(grids.lanes==BATCH_LANES);
+
+    if(input!=NULL && next_grid(&in_stream, &clues, 0))
+        printf("Input file %s has puzzles without solution.\n", input);
+
+    double sec=(double)(clock()-beg)/CLOCKS_PER_SEC;
+    printf("Output file name is %s\n", output);
+    printf("Count of verified sudokus is %zu, invalid are %zu\n", out_stream.grids, n_bad);
+    printf("Verified %zu bytes at %.1f MB/s\n", out_stream.bytes+in_stream.bytes,
+           sec>0 ? (double)(out_stream.bytes+in_stream.bytes)/sec/1e6 : 0.0);
+
+    fclose(out_stream.file);
+    if(input!=NULL)
+        fclose(in_stream.file);
+    exit (n_bad==0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+void stream_open(struct grid_stream *const stream_ptr, char const * const name, char sep, bool clues)
+{
+    int ch;
+
+    stream_ptr->file=fopen(name, "rb");
+    if(stream_ptr->file==NULL)
+        fatal_err("failed to open %s", name);
+    stream_ptr->name=name;
+    stream_ptr->grids=0;
+    stream_ptr->bytes=0;
+    stream_ptr->len=0;
+    stream_ptr->pos=0;
+
+    for(ch=0; ch<(1<<8); ch++)
+        stream_ptr->code[ch]=CH_BAD;
+    for(ch='1'; ch<='9'; ch++)
+        stream_ptr->code[ch]=(uint16_t)(1<<(ch-'1'));
+    if(clues)
+        stream_ptr->code['*']=nine_possible();
+    stream_ptr->code[' ']=0;
+    stream_ptr->code['\n']=0;
+    stream_ptr->code['\r']=0;
+    stream_ptr->code[(unsigned char)sep]=CH_SEP;
+}
+
+bool stream_fill(struct grid_stream *const stream_ptr) // false at EOF
+{
+    stream_ptr->len=fread(stream_ptr->buff, 1, STREAM_BUFF, stream_ptr->file);
+    stream_ptr->pos=0;
+    stream_ptr->bytes+=stream_ptr->len;
+
+    return stream_ptr->len>0;
+}
+
+bool next_grid(struct grid_stream *const stream_ptr, struct sudoku_batch *const batch_ptr, size_t lane)
+{
+    int cell=0;
+    uint16_t code;
+    unsigned char const *p;
+    unsigned char const *end;
+
+    do
+    {
+        if(stream_ptr->pos==stream_ptr->len && !stream_fill(stream_ptr))
+            break;
+        p=(unsigned char const *)stream_ptr->buff+stream_ptr->pos;
+        end=(unsigned char const *)stream_ptr->buff+stream_ptr->len;
+
+        while(p<end) // hot loop over buffer, one table lookup each char
+        {
+            code=stream_ptr->code[*p++];
+            if(code==0)
+                continue;
+            if(code==CH_SEP)
+            {
+                if(cell==0) // separators before grid
+                    continue;
+                p--;
+                break;
+            }
+            if(code==CH_BAD)
+                fatal_err("Unacceptable char in grid %zu of %s, char is %c", stream_ptr->grids+1, stream_ptr->name, p[-1]);
+            if(cell==N_CELLS)
+                fatal_err("Grid %zu of %s has more than %d cells", stream_ptr->grids+1, stream_ptr->name, N_CELLS);
+            batch_ptr->cell[cell++][lane]=code;
+        }
+        stream_ptr->pos=(size_t)(p-(unsigned char const *)stream_ptr->buff);
+    }
+    while(p==end);
+
+    if(cell==0)
+        return false;
+    if(cell!=N_CELLS)
+        fatal_err("Grid %zu of %s has %d cells", stream_ptr->grids+1, stream_ptr->name, cell);
+    stream_ptr->grids++;
+
+    return true;
+}
+
+void stream_seek(struct grid_stream *const stream_ptr, long pos)
+{
+    if(fseek(stream_ptr->file, pos, SEEK_SET)!=0)
+        fatal_err("Can not seek %s to %ld", stream_ptr->name, pos);
+    stream_ptr->bytes=(size_t)pos;
+    stream_ptr->len=0;
+    stream_ptr->pos=0;
+}
+
+long stream_tell(struct grid_stream const *const stream_ptr) // file position of next unread char
+{
+    return (long)(stream_ptr->bytes-stream_ptr->len+stream_ptr->pos);
+}
+
+void verify_batch(struct sudoku_batch const *const grid_ptr, struct sudoku_batch const *const clue_ptr, bool *const bad) // all lanes at once, bad lanes of grid_ptr->lanes are set
+{
+    uint16_t seen[BATCH_LANES];
+    uint16_t fail[BATCH_LANES]={0};
+    int unit;
+    int k;
+    int cell;
+    size_t lane;
+
+    for(unit=0; unit<3*GRID_SIZE; unit++) // each value once in every row, column and region
+    {
+        memset(seen, 0, sizeof(seen));
+        for(k=0; k<GRID_SIZE; k++)
+        {
+            cell=unit_cell(unit, k);
+            for(lane=0; lane<BATCH_LANES; lane++)
+                seen[lane]|=grid_ptr->cell[cell][lane];
+        }
+        for(lane=0; lane<BATCH_LANES; lane++)
+            fail[lane]|=seen[lane]^nine_possible();
+    }
+
+    for(cell=0; cell<N_CELLS; cell++) // grid keeps the clues
+        for(lane=0; lane<BATCH_LANES; lane++)
+            fail[lane]|=grid_ptr->cell[cell][lane]&(uint16_t)~clue_ptr->cell[cell][lane];
+
+    for(lane=0; lane<grid_ptr->lanes; lane++)
+        bad[lane]=fail[lane]!=0;
+}
+
+uint16_t next_cell(uint16_t cell)
+{
+    uint8_t next=try_next(cell);
+    uint16_t first_cell=(uint16_t)(1<<(next-1));
+
+    if(!is_single_value(first_cell))
+        fatal_err("first_cell is %u",first_cell);
+
+    print_info("^ %s:cell is %u first_cell is %u\n", __FUNCTION__, cell, first_cell);
+
+    return first_cell;
+}
+
+uint8_t try_next(uint16_t cell)
+{
+    unsigned count;
+    uint8_t next=0;
+
+    if(cell==0)
+        fatal_err("Initial cell is %u",cell);
+
+    count=count_zero_bits_on_right(cell);
+
+    next=(uint8_t)(count+1);
+
+    if(!(next>=1 && next<=9))
+        fatal_err("Invalid next %u",next);
 
-    if(dt >= rt)
-        fatal_err("time is over, time passed %f seconds",dt);
+    return next;
 }
 
-void update_3(ss_t *const root_ptr, ss_t *const ss1_ptr,ss_t *const ss2_ptr)
+///////////////////////////////////////
+
+ss_t * go_back(ss_t *root_ptr, ss_t * end_ptr) // conflict directed backjumping
 {
-    implement_constraints(ss1_ptr);
-    *ss2_ptr=*ss1_ptr;
+    ss_t *dead_ptr=end_ptr-1;
+    ss_t *path[UINT8_MAX+1];
+    struct literal lits[UINT8_MAX];
+    bool keep[UINT8_MAX];
+    size_t k;
+    size_t m;
 
-    update_hashes(ss2_ptr);
+    do
+    {
+        k=decision_path(root_ptr, dead_ptr, path, lits);
+        m=analyse_conflict(root_ptr, lits, k, keep);
+        if(m==0)
+            fatal_err("Search space exhausted, problem is unsolvable.");
+        nogood_add(lits, keep, m);
+
+        print_info("$ backjump from depth %zu to %zu\n", k, m-1);
+
+        dead_ptr=path[m-1]; // decision m is refuted by decisions before it
+        dead_ptr->cell[lits[m-1].cell] &= (uint16_t)~lits[m-1].value;
+        zero_minhash(dead_ptr);
+        implement_constraints(dead_ptr);
+    }
+    while(no_solution(dead_ptr));
 
-    if(is_unsolvable(*ss2_ptr))
-        fatal_err("Problem is unsolvable after implementing constraints.");
+    if(dead_ptr==root_ptr) // value is refuted for every run
+        restart.best=*root_ptr;
 
-    *root_ptr=*ss2_ptr;
-    return;
+    *end_ptr=*dead_ptr;
+    return dead_ptr;
 }
 
-void solve_info(int row, int column,size_t n1,size_t n2)
+size_t decision_path(ss_t *root_ptr, ss_t *dead_ptr, ss_t **path, struct literal *lits)
 {
-    UNUSED(row);
-    UNUSED(column);
-    UNUSED(n1);
-    UNUSED(n2);
-    print_info("// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ //\n");
+    size_t k=dead_ptr->head.depth;
+    size_t d;
+    ss_t *ss_ptr=dead_ptr;
 
-    print_info("row is %d, column is %d, n is %zu n2 is %zu\n", row, column, n1, n2);
+    for(d=k; d>0; d--)
+    {
+        lits[d-1].cell=ss_ptr->head.decision_cell;
+        lits[d-1].value=ss_ptr->head.decision_value;
+        ss_ptr=root_ptr+ss_ptr->head.parent;
+        path[d-1]=ss_ptr;
+    }
+    if(ss_ptr!=root_ptr)
+        fatal_err("decision path does not end at root");
 
-    print_info("// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ //\n");
+    return k;
 }
 
-noreturn void solve(char const * const input, char const * const output, double const rt_input, unsigned nmax)
+size_t analyse_conflict(ss_t const *root_ptr, struct literal const *lits, size_t k, bool *keep)
 {
-    time_t time_beg;
-    time(&time_beg);
+    size_t d;
+    size_t m=0;
 
-    ss_t ss;
-    ss_t ss2;
+    for(d=0; d<k; d++)
+        keep[d]=true;
 
-    ss_t *root_ptr;
-    ss_t *end_ptr;
-    size_t n=1;
-    size_t n2=0;
-    int row=0;
-    int column=0;
+    if(literals_fail(root_ptr, lits, keep, k)) // drop newest decisions first, for longer jumps
+    {
+        for(d=k; d>0; d--)
+        {
+            keep[d-1]=false;
+            if(!literals_fail(root_ptr, lits, keep, k))
+                keep[d-1]=true;
+        }
+    }
 
-    long file_pos=0;
-    int count = 0;
+    for(d=0; d<k; d++)
+        if(keep[d])
+            m=d+1;
 
-    FILE* output_file=fopen(output, "wt");
-    if(output_file==NULL)
-        fatal_err("Initially can not open output file %s", output);
-    fprintf(output_file, "%c\n", output_sep);
-    fclose(output_file);
+    return m; // deepest decision in conflict
+}
 
-    FILE* input_file=NULL;
-    output_file=fopen(output, "at");
-        if(output_file==NULL)
-            fatal_err("Can not open output file %s", output);
+bool literals_fail(ss_t const *root_ptr, struct literal const *lits, bool const *keep, size_t k)
+{
+    ss_t ss=*root_ptr;
+    size_t d;
 
-    input_file=fopen(input, "rt");
-    if(input_file==NULL)
-        fatal_err("failed to open %s",input);
-    
-    do
+    zero_minhash(&ss);
+    for(d=0; d<k; d++)
     {
-        check_time(time_beg, rt_input);
-
-        fseek(input_file, file_pos * (long)sizeof(char), SEEK_SET);
-        if(feof(input_file))
-            print_finish(input, output, count, time_beg);
-
-        fseek(input_file, file_pos * (long)sizeof(char), SEEK_SET);
-        file_pos=ftell(input_file);
+        if(!keep[d])
+            continue;
+        if(!(ss.cell[lits[d].cell] & lits[d].value))
+            return true;
+        ss.cell[lits[d].cell]=lits[d].value;
+    }
+    propagate(&ss);
 
-        root_ptr=my_alloc(ALLOC_FACTOR*sizeof(ss_t));
-        if(root_ptr==NULL)
-            fatal_err("root_ptr malloc failed.");
-        end_ptr=root_ptr+1;
+    return no_solution(&ss);
+}
 
-        ss=get_ss(input, output, count, time_beg);
-        count++;
+void propagate(ss_t *const ss_ptr) // implement_constraints to a fixed point
+{
+    uint16_t before[N_CELLS];
 
-        if(is_unsolvable(ss))
-            fatal_err("Problem is unsolvable initially.");
-        if(has_contra(ss))
-            fatal_err("Problem has contradiction initially.");
+    do
+    {
+        memcpy(before, ss_ptr->cell, sizeof(before));
+        implement_constraints(ss_ptr);
+    }
+    while(memcmp(before, ss_ptr->cell, sizeof(before))!=0 && !is_unsolvable(ss_ptr));
+}
 
-        update_3(root_ptr,&ss,&ss2);
+void nogood_add(struct literal const *lits, bool const *keep, size_t k)
+{
+    struct nogood ng={.len=0};
+    size_t d;
 
-        print_info("// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ //\n");
-        if(sudoku_is_solved_hashwise(&ss2))
+    for(d=0; d<k; d++)
+        if(keep[d])
         {
-            printf("Problem is solved after implementing constraints.\n");
-            print_solved(&ss2, output, n);
-            continue;
+            if(ng.len==NOGOOD_LEN)
+                return;
+            ng.lit[ng.len++]=lits[d];
         }
 
-        end_ptr=fill_cells(root_ptr, n, false, output, nmax);
-        if(end_ptr==NULL)
-            fatal_err("end_ptr returned from fill_cells is NULL");
+    nogoods.ng[nogoods.next]=ng;
+    nogoods.next=(nogoods.next+1)%NOGOOD_MAX;
+    if(nogoods.count<NOGOOD_MAX)
+        nogoods.count++;
+}
+
+void nogood_prune(ss_t *const ss_ptr) // a nogood with all literals but one true removes the last
+{
+    size_t i;
+    uint8_t j;
 
-        if(end_ptr->hash==MAX_HASH)
-            print_info("\nFilled all cells,row is %d column is %d n is %zu\n",row, column, n);
+    for(i=0; i<nogoods.count; i++)
+    {
+        struct nogood const *const ng=&nogoods.ng[i];
+        int open=-1;
+        bool satisfied=false;
 
-        if(sudoku_is_solved_hashwise(end_ptr))
+        for(j=0; j<ng->len; j++)
         {
-            printf("Problem is solved after filling.\n");
+            uint16_t cell=ss_ptr->cell[ng->lit[j].cell];
+            if(!(cell & ng->lit[j].value))
+            {
+                satisfied=true;
+                break;
+            }
+            if(cell!=ng->lit[j].value)
+            {
+                if(open>=0)
+                    break;
+                open=j;
+            }
+        }
+        if(satisfied || j<ng->len)
             continue;
+
+        if(open<0) // every literal holds
+        {
+            open=0;
+            zero_minhash(ss_ptr);
         }
+        ss_ptr->cell[ng->lit[open].cell] &= (uint16_t)~ng->lit[open].value;
+    }
+}
 
-        solve_info(row, column, n, n2);
-        n = 1;
-        free(end_ptr);
-        update_hashes(&ss2);
+void nogood_clear(void)
+{
+    nogoods.count=0;
+    nogoods.next=0;
+}
 
-        fprint_ss(stdout, *end_ptr);
+void peers_init(void)
+{
+    int i;
+    int j;
+    int k;
 
-        if(root_ptr!=NULL)
-            free(root_ptr);
-        if(end_ptr!=NULL)
-            free(end_ptr);
+    for(i=0; i<N_CELLS; i++)
+    {
+        k=0;
+        for(j=0; j<N_CELLS; j++)
+            if(j!=i && row_column_region((uint8_t)(i/GRID_SIZE), (uint8_t)(i%GRID_SIZE),
+                                          (uint8_t)(j/GRID_SIZE), (uint8_t)(j%GRID_SIZE)))
+                peers[i][k++]=(uint8_t)j;
+        if(k!=PEERS)
+            fatal_err("cell %d has %d peers", i, k);
     }
-    while(true);
-    
-    fclose(input_file);
-    fclose(output_file);
 }
 
-uint16_t next_cell(uint16_t cell)
+uint16_t select_cell(ss_t const*const current_ptr, int *row_ptr, int *column_ptr)
 {
-    uint8_t next=try_next(cell);
-    uint16_t first_cell=(uint16_t)(1<<(next-1));
+    int row;
+    int column;
+    uint8_t min_pc=GRID_SIZE+1;
+    unsigned ties=0;
 
-    if(!is_single_value(first_cell))
-        fatal_err("first_cell is %u",first_cell);
+    if(restart.policy==RESTART_NONE)
+        return first_multi_value_cell(current_ptr, row_ptr, column_ptr);
 
-    print_info("^ %s:cell is %u first_cell is %u\n", __FUNCTION__, cell, first_cell);
+    *row_ptr=GRID_SIZE-1;
+    *column_ptr=GRID_SIZE-1;
+    for(row=0; row<GRID_SIZE; row++)
+        for(column=0; column<GRID_SIZE; column++)
+        {
+            uint8_t pc=popcnt(current_ptr->cell[IDX(row,column)]);
+            if(pc<2 || pc>min_pc)
+                continue;
+            if(pc<min_pc)
+            {
+                min_pc=pc;
+                ties=0;
+            }
+            ties++;
+            if(rand()%ties==0) // reservoir sampling among ties
+            {
+                *row_ptr=row;
+                *column_ptr=column;
+            }
+        }
 
-    return first_cell;
+    return current_ptr->cell[IDX(*row_ptr,*column_ptr)];
 }
 
-uint8_t try_next(uint16_t cell) // TODO order can be other heuristic rather than 1..9
+uint16_t select_value(uint16_t cell)
 {
-    unsigned count;
-    uint8_t next=0;
+    if(restart.policy==RESTART_NONE)
+        return next_cell(cell);
 
     if(cell==0)
         fatal_err("Initial cell is %u",cell);
 
-    count=count_zero_bits_on_right(cell);
+    int k=rand()%popcnt(cell);
+    while(k-- > 0)
+        cell=remove_right_one(cell);
 
-    next=(uint8_t)(count+1);
+    return (uint16_t)(cell & -cell);
+}
 
-    if(!(next>=1 && next<=9))
-        fatal_err("Invalid next %u",next);
+size_t luby(unsigned i)
+{
+    size_t k;
 
-    return next;
-}
+    if(i==0)
+        fatal_err("luby sequence begins from 1");
 
-///////////////////////////////////////
+    for(k=1; ((size_t)1<<k)-1 < i; k++)
+        ;
+    if(((size_t)1<<k)-1 == i)
+        return (size_t)1<<(k-1);
 
-ss_t * go_back(ss_t *root_ptr, ss_t * end_ptr)
-{
-    ss_t * curr1_ptr;
-    for(curr1_ptr=end_ptr-1; curr1_ptr>root_ptr; curr1_ptr--)
-    {
-        if(!no_solution(*curr1_ptr))
-        {
-            implement_constraints(curr1_ptr);
-            *end_ptr=*curr1_ptr;
+    return luby(i-(unsigned)(((size_t)1<<(k-1))-1));
+}
 
-            if(!no_solution(*end_ptr))
-                break;
-        }
-    }
+size_t restart_limit(unsigned run) // at most restart.max_limit
+{
+    double limit=RESTART_UNIT;
+    unsigned k;
 
-    int row, column;
-    uint16_t current_cell=first_multi_value_cell(curr1_ptr, &row, &column);
-    uint64_t removed=current_cell;
-    
-    if(!(row==GRID_SIZE-1 && column==GRID_SIZE-1)) // TODO maybe more backward
+    switch(restart.policy)
     {
-        removed = remove_right_one(current_cell);
-        curr1_ptr->cell[row][column] = removed;
+    case RESTART_LUBY:
+        limit=(double)RESTART_UNIT*(double)luby(run);
+        break;
+    case RESTART_GEOMETRIC:
+        for(k=1; k<run && limit<(double)restart.max_limit; k++)
+            limit*=RESTART_FACTOR;
+        break;
+    case RESTART_NONE:
+    default:
+        return 0;
     }
-    if(is_single_value(removed))
-        implement_constraints(curr1_ptr);
-        
-    *end_ptr=*curr1_ptr;
-    
-    assert(curr1_ptr >= root_ptr);
-    assert(curr1_ptr <= end_ptr);
-    return curr1_ptr;
+
+    return limit<(double)restart.max_limit ? (size_t)limit : restart.max_limit;
+}
+
+void restart_init(ss_t const *const root_ptr)
+{
+    restart.best=*root_ptr;
+    restart.run=1;
+    restart.limit=restart_limit(restart.run);
+}
+
+bool restart_due(size_t n)
+{
+    return restart.policy!=RESTART_NONE && n>restart.limit;
+}
+
+void restart_search(ss_t *const root_ptr)
+{
+    *root_ptr=restart.best;
+    restart.run++;
+    restart.limit=restart_limit(restart.run);
+
+    print_info("$ restart %u, limit is %zu\n", restart.run, restart.limit);
+}
+
+enum restart_policy get_policy(char const *const name)
+{
+    if(strcmp(name, "none")==0)
+        return RESTART_NONE;
+    if(strcmp(name, "luby")==0)
+        return RESTART_LUBY;
+    if(strcmp(name, "geometric")==0)
+        return RESTART_GEOMETRIC;
+
+    fatal_err("Unknown restart policy %s", name);
 }
 
 void print_solved(ss_t const *const end_ptr, char const *const output, size_t n)
@@ -436,18 +1479,17 @@ void print_solved(ss_t const *const end_ptr, char const *const output, size_t n)
     UNUSED(n);
     print_info("Problem is solved, n is %zu\n",n);
 
-    fprint_ss(stdout, *end_ptr);
+    fprint_ss(stdout, end_ptr);
 
-    FILE* output_file=fopen(output, "at");
-    fprint_ss(output_file, *end_ptr);
-    fprintf(output_file, "%c\n", output_sep);
-
-    fclose(output_file);
+    if(out_file==NULL)
+        fatal_err("Output file %s is not open", output);
+    fprint_ss(out_file, end_ptr);
+    fprintf(out_file, "%c\n", output_sep);
 }
 
 void print_contra(ss_t const *const end_ptr, bool contra, bool pre_contra)
 {
-    contra=has_contra(*end_ptr);
+    contra=has_contra(end_ptr);
 
     char pc_str[10]= {'\0'};
     char c_str[10]= {'\0'};
@@ -460,18 +1502,18 @@ void print_contra(ss_t const *const end_ptr, bool contra, bool pre_contra)
 
 uint16_t first_multi_value_cell(ss_t const*const current_ptr, int *row_ptr, int *column_ptr)
 {
-    uint16_t current_cell=current_ptr->cell[0][0];
+    uint16_t current_cell=current_ptr->cell[IDX(0,0)];
     int row=0;
     int column=0;
 
     for(row=0; row<=(GRID_SIZE-1); row++)
     {
-        current_cell=current_ptr->cell[row][column];
+        current_cell=current_ptr->cell[IDX(row,column)];
         if(!is_single_value(current_cell))
             break;
         for(column=0; column<=(GRID_SIZE-1); column++)
         {
-            current_cell=current_ptr->cell[row][column];
+            current_cell=current_ptr->cell[IDX(row,column)];
             if(!is_single_value(current_cell))
             {
                 print_info("` contra is false, row is %d, column is %d \n",row,column);
@@ -487,7 +1529,7 @@ uint16_t first_multi_value_cell(ss_t const*const current_ptr, int *row_ptr, int
             continue;
         }
 
-        current_cell=current_ptr->cell[row][column];
+        current_cell=current_ptr->cell[IDX(row,column)];
         if(!is_single_value(current_cell))
             break;
     }
@@ -529,6 +1571,12 @@ ss_t * fill_cells(ss_t * root_ptr, size_t n, bool pre_contra, char const * const
 
     if(n==0)
         fatal_err("n is 0");
+    if(restart_due(n))
+    {
+        restart_search(root_ptr);
+        n=1;
+        pre_contra=false;
+    }
     if(n>=nmax )
         fatal_err("n exceeded nmax, n is %zu",n);
 
@@ -573,13 +1621,13 @@ ss_t * fill_cells(ss_t * root_ptr, size_t n, bool pre_contra, char const * const
 
     row=0;
     column=0;
-    root_cell=root_ptr->cell[row][column];
-    end_cell=end_ptr->cell[row][column];
+    root_cell=root_ptr->cell[IDX(row,column)];
+    end_cell=end_ptr->cell[IDX(row,column)];
 
     update(root_ptr,current_ptr);
-    fprint_ss(stdout, *current_ptr);
+    fprint_ss(stdout, current_ptr);
 
-    first_uneq_cell(*current_ptr,*end_ptr,&row,&column);
+    first_uneq_cell(current_ptr,end_ptr,&row,&column);
 
     print_info("\n`` first_uneq_cell, row is %d column is %d\n",row,column);
     uint16_t cc1=nine_possible();
@@ -587,8 +1635,8 @@ ss_t * fill_cells(ss_t * root_ptr, size_t n, bool pre_contra, char const * const
     if(!(row==GRID_SIZE-1 && column==GRID_SIZE-1))
     {
         print_info("$ row is %d, column is %d\n",row,column);
-        cc1=current_ptr->cell[row][column];
-        ec1=end_ptr->cell[row][column];
+        cc1=current_ptr->cell[IDX(row,column)];
+        ec1=end_ptr->cell[IDX(row,column)];
         print_cell(cc1);
         print_cell(ec1);
 
@@ -614,23 +1662,27 @@ ss_t * fill_cells(ss_t * root_ptr, size_t n, bool pre_contra, char const * const
 
         uint16_t current_cell;
 
-        current_cell=first_multi_value_cell(current_ptr,&row, &column);
+        current_cell=select_cell(current_ptr,&row, &column);
 
         print_info("` row is %d, column is %d\n",row,column);
-        root_cell=root_ptr->cell[row][column];
-        current_cell=current_ptr->cell[row][column];
-        uint16_t cell=current_ptr->cell[row][column];
+        root_cell=root_ptr->cell[IDX(row,column)];
+        current_cell=current_ptr->cell[IDX(row,column)];
+        uint16_t cell=current_ptr->cell[IDX(row,column)];
 
         print_4_cells(root_cell,current_cell, cell, end_cell);
 
-        uint16_t n_cell=next_cell(cell);
+        uint16_t n_cell=select_value(cell);
         uint16_t esv_cell=cell;
 
         print_cell(n_cell);
         print_cell(esv_cell);
 
         *end_ptr=*current_ptr;
-        end_ptr->cell[row][column]=n_cell;
+        end_ptr->cell[IDX(row,column)]=n_cell;
+        end_ptr->head.parent=(int16_t)(current_ptr-root_ptr);
+        end_ptr->head.depth=(uint8_t)(current_ptr->head.depth+1);
+        end_ptr->head.decision_cell=(uint8_t)IDX(row,column);
+        end_ptr->head.decision_value=n_cell;
 
         zero_minhash(end_ptr);
 
@@ -643,7 +1695,7 @@ ss_t * fill_cells(ss_t * root_ptr, size_t n, bool pre_contra, char const * const
         if(ir)
             print_info("`` ir is true, pc is %u\n",pc);
 
-        end_ptr->cell[row][column]=n_cell;
+        end_ptr->cell[IDX(row,column)]=n_cell;
 
         update(root_ptr,end_ptr);
 
@@ -655,13 +1707,13 @@ ss_t * fill_cells(ss_t * root_ptr, size_t n, bool pre_contra, char const * const
 
         zero_minhash(current_ptr);
         
-        current_ptr->cell[row][column]=esv_cell;
+        current_ptr->cell[IDX(row,column)]=esv_cell;
 
         update(root_ptr,current_ptr);
 
         print_cell(esv_cell);
 
-        bool hce=has_contra(*end_ptr);
+        bool hce=no_solution(end_ptr);
         
         end_ptr=fill_cells(root_ptr, n+1, hce, output, nmax);
     }
@@ -671,7 +1723,7 @@ ss_t * fill_cells(ss_t * root_ptr, size_t n, bool pre_contra, char const * const
 
 void zero_minhash(ss_t * const ss_ptr)
 {
-    ss_ptr->min_hash=0;
+    ss_ptr->head.min_hash=0;
     return;
 }
 
@@ -685,12 +1737,7 @@ void update_hashes(ss_t *const ss_ptr)
 
 uint16_t nine_possible(void)
 {
-    uint16_t r=0;
-    unsigned sv;
-    for(sv=ONE; sv<=NINE; sv<<=1)
-        r |= sv;
-
-    return r;
+    return (uint16_t)((NINE<<1)-ONE);
 }
 
 void compute_hash(ss_t *ss_ptr)
@@ -701,12 +1748,12 @@ void compute_hash(ss_t *ss_ptr)
 
     for(row=0; row<GRID_SIZE; row++)
         for(column=0; column<GRID_SIZE; column++)
-            if(is_single_value(ss_ptr->cell[row][column]))
+            if(is_single_value(ss_ptr->cell[IDX(row,column)]))
                 hash++;
 
-    if(hash<ss_ptr->min_hash || hash>MAX_HASH)
+    if(hash<ss_ptr->head.min_hash || hash>MAX_HASH)
         fatal_err("wrong hash in compute_hash, hash is %u", hash);
-    ss_ptr->hash = hash;
+    ss_ptr->head.hash = hash;
     return;
 }
 
@@ -717,35 +1764,7 @@ unsigned count_zero_bits_on_right(uint32_t v)
     if(v==0)
         fatal_err("failed, v is %u",v);
 
-    if (v & 0x1)
-    {
-        c = 0;
-    }
-    else
-    {
-        c = 1;
-        if ((v & 0xffff) == 0)
-        {
-            v >>= 16;
-            c += 16;
-        }
-        if ((v & 0xff) == 0)
-        {
-            v >>= 8;
-            c += 8;
-        }
-        if ((v & 0xf) == 0)
-        {
-            v >>= 4;
-            c += 4;
-        }
-        if ((v & 0x3) == 0)
-        {
-            v >>= 2;
-            c += 2;
-        }
-        c -= v & 0x1;
-    }
+    c=bit_ops.ctz(v);
 
     if(c>GRID_SIZE)
         fatal_err("Count zero bits failed, c is %u\n",c);
@@ -755,52 +1774,24 @@ unsigned count_zero_bits_on_right(uint32_t v)
 
 bool is_single_value(uint16_t value)
 {
-    unsigned sv;
-
-    for(sv=ONE; sv<=NINE; sv<<=1)
-        if(value == sv)
-        {
-            assert(popcnt(value)==1);
-            return true;
-        }
-
-    assert(popcnt(value) != 1);
-    return false;
+    return value!=0 && (value & (value-1))==0 && value<=NINE;
 }
 
-bool sudoku_states_equal(ss_t ss1, ss_t ss2)
+bool sudoku_states_equal(ss_t const *const ss1_ptr, ss_t const *const ss2_ptr)
 {
-    unsigned row;
-    unsigned column;
-    bool r=true;
-    uint16_t ss1_cell;
-    uint16_t ss2_cell;
-
-    if(ss1.hash != ss2.hash)
-        r=false;
-
-    if(r==true)
-    {
-        for(row=0; row<GRID_SIZE; row++)
-            for(column=0; column<GRID_SIZE; column++)
-            {
-                ss1_cell=ss1.cell[row][column];
-                ss2_cell=ss2.cell[row][column];
+    bool r;
 
-                if(ss1_cell != ss2_cell)
-                    r=false;
-            }
-    }
+    if(ss1_ptr->head.hash != ss2_ptr->head.hash)
+        return false;
 
-    if(r==true && (ss1.hash!=ss2.hash) )
-        fatal_err("sudoku states are equal, but hashes are not.");
+    r = memcmp(ss1_ptr->cell, ss2_ptr->cell, sizeof(ss1_ptr->cell))==0;
 
     return r;
 }
 
 bool sudoku_is_solved_hashwise(ss_t * ss_ptr)
 {
-    if(ss_ptr->hash == MAX_HASH && ss_ptr->contra==false)
+    if(ss_ptr->head.hash == MAX_HASH && ss_ptr->head.contra==false)
         return true;
 
     return false;
@@ -825,6 +1816,7 @@ void implement_constraints(ss_t * const ss_ptr)
     hidden_row(ss_ptr);
     hidden_column(ss_ptr);
     // TODO hidden region
+    nogood_prune(ss_ptr);
 
     compute_hash(ss_ptr);
 
@@ -834,40 +1826,30 @@ void implement_constraints(ss_t * const ss_ptr)
 
 void naked_cell(ss_t * ss_ptr)
 {
-    uint8_t row;
-    uint8_t column;
-    uint8_t row2;
-    uint8_t column2;
+    int i;
+    int j;
     uint16_t first_cell=nine_possible();
     uint16_t second_cell=nine_possible();
 
-    for(row=0; row<GRID_SIZE; row++)
-        for(column=0; column<GRID_SIZE; column++)
-            for(row2=0; row2<GRID_SIZE; row2++)
-                for(column2=0; column2<GRID_SIZE; column2++)
-                {
-                    if(row==row2 && column==column2) // ignore same cell
-                        continue;
-
-                    if(row_column_region(row,column,row2,column2))
-                    {
-                        first_cell=ss_ptr->cell[row][column];
-                        second_cell=ss_ptr->cell[row2][column2];
-                        if(is_single_value(first_cell) && !is_single_value(second_cell) )
-                        {
-                            second_cell=eliminate_single_value(first_cell,second_cell);
-                            ss_ptr->cell[row2][column2]=second_cell;
-                        }
-
-                        if(!is_single_value(first_cell) && is_single_value(second_cell) )
-                        {
-                            first_cell=eliminate_single_value(second_cell,first_cell);
-                            ss_ptr->cell[row][column]=first_cell;
-                        }
-                        ss_ptr->cell[row][column]=first_cell;
-                        ss_ptr->cell[row2][column2]=second_cell;
-                    }
-                }
+    for(i=0; i<N_CELLS; i++)
+        for(j=0; j<PEERS; j++)
+        {
+            int const i2=peers[i][j];
+
+            first_cell=ss_ptr->cell[i];
+            second_cell=ss_ptr->cell[i2];
+            if(is_single_value(first_cell) && !is_single_value(second_cell) )
+            {
+                second_cell=eliminate_single_value(first_cell,second_cell);
+                ss_ptr->cell[i2]=second_cell;
+            }
+
+            if(!is_single_value(first_cell) && is_single_value(second_cell) )
+            {
+                first_cell=eliminate_single_value(second_cell,first_cell);
+                ss_ptr->cell[i]=first_cell;
+            }
+        }
     return;
 }
 void hidden_row(ss_t * ss_ptr)
@@ -883,11 +1865,11 @@ void hidden_row(ss_t * ss_ptr)
             {
                 if(j==i)
                     continue;
-                rest8 |= ss_ptr->cell[row][j];
+                rest8 |= ss_ptr->cell[IDX(row,j)];
             }
-            uint16_t missing = nine_possible() & ~rest8 & ss_ptr->cell[row][i];
+            uint16_t missing = nine_possible() & ~rest8 & ss_ptr->cell[IDX(row,i)];
             if(is_single_value(missing))
-                ss_ptr->cell[row][i] = missing;
+                ss_ptr->cell[IDX(row,i)] = missing;
         }
     return;
 }
@@ -904,11 +1886,11 @@ void hidden_column(ss_t * ss_ptr)
             {
                 if(j==i)
                     continue;
-                rest8 |= ss_ptr->cell[j][column];
+                rest8 |= ss_ptr->cell[IDX(j,column)];
             }
-            uint16_t missing = nine_possible() & ~rest8 & ss_ptr->cell[i][column];
+            uint16_t missing = nine_possible() & ~rest8 & ss_ptr->cell[IDX(i,column)];
             if(is_single_value(missing))
-                ss_ptr->cell[i][column] = missing;
+                ss_ptr->cell[IDX(i,column)] = missing;
         }
     return;
 }
@@ -956,26 +1938,14 @@ bool in_range(uint8_t v,uint8_t min, uint8_t max )
     return false;
 }
 
-bool is_unsolvable(ss_t ss)
+bool is_unsolvable(ss_t const *const ss_ptr)
 {
-    uint8_t row;
-    uint8_t column;
-    uint16_t cell=0;
+    unsigned i;
     uint16_t apic=nine_possible();
 
-    for(row=0; row<GRID_SIZE; row++)
+    for(i=0; i<N_CELLS; i++)
     {
-        for(column=0; column<GRID_SIZE; column++)
-        {
-            cell=ss.cell[row][column];
-            apic=nine_possible();
-            if(cell==0 || cell>apic)
-                return true;
-        }
-        if(column>GRID_SIZE-1)
-            column=GRID_SIZE-1;
-        cell=ss.cell[row][column];
-        apic=nine_possible();
+        uint16_t cell=ss_ptr->cell[i];
         if(cell==0 || cell>apic)
             return true;
     }
@@ -983,16 +1953,15 @@ bool is_unsolvable(ss_t ss)
     return false;
 }
 
-bool has_contra(ss_t ss)
+bool has_contra(ss_t const *const ss_ptr)
 {
-    compute_contra(&ss);
-    return ss.contra;
+    return find_contra(ss_ptr);
 }
 
-bool no_solution(ss_t ss)
+bool no_solution(ss_t const *const ss_ptr)
 {
     bool r;
-    r = is_unsolvable(ss) || has_contra(ss);
+    r = is_unsolvable(ss_ptr) || has_contra(ss_ptr);
     return r;
 }
 
@@ -1007,26 +1976,23 @@ void update(ss_t * const root_ptr, ss_t * const ss_ptr)
 
     update_hashes(ss_ptr);
 
-    ss_ptr->min_hash=root_ptr->hash;
+    ss_ptr->head.min_hash=root_ptr->head.hash;
 
     return;
 }
 
-ss_t get_ss(char const * const input, char const * const output, int count, time_t begin)
+bool get_ss(char const * const input, ss_t *const ss_ptr)
 {
     unsigned row=0;
     unsigned column=0;
 
-    ss_t ss1 = {.min_hash=0,.hash=0, .contra=false, .cell={{0}} };
+    ss_t ss1 = {.cell={0}, .head={.min_hash=0, .hash=0, .contra=false}};
     FILE *input_file = NULL;
     char line[LINE_LEN]= {'\n','\0'};
     char ch='0';
 
     uint16_t apic=0;
     uint16_t hash=0;
-    ss_t *ss_ptr=&ss1;
-
-    static long file_pos=0;
 
     if(ss_ptr==NULL)
         fatal_err("wrong pointer.");
@@ -1050,7 +2016,8 @@ ss_t get_ss(char const * const input, char const * const output, int count, time
         fscanf(input_file, "%125s\n", line);
         if(feof(input_file) )
         {
-            print_finish(input, output, count, begin);
+            fclose(input_file);
+            return false;
         }
 
     }
@@ -1074,7 +2041,7 @@ ss_t get_ss(char const * const input, char const * const output, int count, time
 
             apic=nine_possible();
 
-            ss1.cell[row][column] = (uint16_t)(ch=='*' ? apic : 1<<(ch-'1') );
+            ss1.cell[IDX(row,column)] = (uint16_t)(ch=='*' ? apic : 1<<(ch-'1') );
         }
 
     }
@@ -1089,14 +2056,15 @@ ss_t get_ss(char const * const input, char const * const output, int count, time
     fclose(input_file);
 
     compute_hash(&ss1);
-    ss1.hash=hash;
+    ss1.head.hash=hash;
 
-    ss1.min_hash=hash;
+    ss1.head.min_hash=hash;
 
-    return ss1;
+    *ss_ptr=ss1;
+    return true;
 }
 
-void fprint_ss(FILE* output_file, ss_t ss)
+void fprint_ss(FILE* output_file, ss_t const *const ss_ptr)
 {
     unsigned row;
     unsigned column;
@@ -1107,15 +2075,15 @@ void fprint_ss(FILE* output_file, ss_t ss)
     if(output_file == stdout)
     {
 #ifdef DEBUG
-        fprintf(output_file, "\nhash is %u\n", ss.hash);
-        fprintf(output_file, "contra is %u\n", ss.contra);
+        fprintf(output_file, "\nhash is %u\n", ss_ptr->head.hash);
+        fprintf(output_file, "contra is %u\n", ss_ptr->head.contra);
 
         fprintf(output_file, "Value in cells:\n");
         for(row=0; row<GRID_SIZE; row++)
         {
             for(column=0; column<GRID_SIZE; column++)
             {
-                uint16_t cell = ss.cell[row][column];
+                uint16_t cell = ss_ptr->cell[IDX(row,column)];
                 if(is_single_value(cell))
                     uc = count_zero_bits_on_right(cell)+1;
                 else
@@ -1138,7 +2106,7 @@ void fprint_ss(FILE* output_file, ss_t ss)
         {
             for(column=0; column<GRID_SIZE; column++)
             {
-                cell=ss.cell[row][column];
+                cell=ss_ptr->cell[IDX(row,column)];
                 if(is_single_value(cell))
                 {
 
@@ -1168,7 +2136,7 @@ void fprint_ss(FILE* output_file, ss_t ss)
         for(row=0; row<GRID_SIZE; row++)
         {
             for(column=0; column<GRID_SIZE; column++)
-                fprintf(output_file, is_single_value(ss.cell[row][column])==true ? "1 " : "0 ");
+                fprintf(output_file, is_single_value(ss_ptr->cell[IDX(row,column)])==true ? "1 " : "0 ");
             fprintf(output_file, "\n");
         }
 
@@ -1219,17 +2187,91 @@ void *my_alloc( size_t size )
     return alloc_ptr;
 }
 
+ss_t *alloc_states(size_t n) // cache line aligned
+{
+    ss_t *states_ptr = aligned_alloc(CACHE_LINE, n*sizeof(ss_t));
+
+    if(states_ptr == NULL)
+        fatal_err("states_ptr memory allocation failed.");
+
+    return states_ptr;
+}
+
 uint8_t popcnt(uint32_t v)
 {
+    return bit_ops.popcnt(v);
+}
+
+uint8_t popcnt_table(uint32_t v)
+{
+    return (uint8_t)(popcnt_tab[v & 0xff] + popcnt_tab[(v>>8) & 0xff]
+                     + popcnt_tab[(v>>16) & 0xff] + popcnt_tab[v>>24]);
+}
+
+unsigned ctz_table(uint32_t v)
+{
+    unsigned c=0;
+
+    while((v & 0xff)==0)
+    {
+        v>>=8;
+        c+=8;
+    }
+    return c+ctz_tab[v & 0xff];
+}
+
+#ifdef HW_BITOPS
+__attribute__((target("popcnt"))) uint8_t popcnt_hw(uint32_t v)
+{
+    return (uint8_t)__builtin_popcount(v);
+}
+
+__attribute__((target("bmi"))) unsigned ctz_hw(uint32_t v)
+{
+    return (unsigned)__builtin_ctz(v); // tzcnt
+}
+#endif // HW_BITOPS
+
+void bitops_init(void)
+{
+    unsigned v;
     uint8_t c;
-    for (c = 0; v; c++)
+    uint32_t u;
+
+    for(v=0; v<(1<<8); v++)
     {
-        v &= v - 1; // clear the least significant bit set
+        for(c=0, u=v; u; c++)
+            u &= u - 1; // clear the least significant bit set
+        popcnt_tab[v]=c;
+
+        for(c=0; c<8 && !(v & (ONE<<c)); c++)
+            ;
+        ctz_tab[v]=c;
     }
-    return c;
+
+#ifdef HW_BITOPS
+    static char const *const names[2][2]= // [popcnt][tzcnt] in hardware
+    {
+        {"table", "table popcnt, tzcnt"},
+        {"popcnt, table ctz", "popcnt, tzcnt"}
+    };
+    bool hw_popcnt;
+    bool hw_ctz;
+
+    __builtin_cpu_init();
+    hw_popcnt=__builtin_cpu_supports("popcnt");
+    hw_ctz=__builtin_cpu_supports("bmi");
+    if(hw_popcnt)
+        bit_ops.popcnt=popcnt_hw;
+    if(hw_ctz)
+        bit_ops.ctz=ctz_hw;
+    bit_ops.name=names[hw_popcnt][hw_ctz];
+#endif // HW_BITOPS
+
+    print_info("$ bit operations are %s\n", bit_ops.name);
 }
 
-void first_uneq_cell(const ss_t current_ptr, const ss_t end_ptr,int *const row,int *const column)
+void first_uneq_cell(ss_t const *const current_ptr, ss_t const *const end_ptr, int *const row, int *const column)
 {
     uint16_t current_cell=0;
     uint16_t end_cell=0;
@@ -1244,8 +2286,8 @@ void first_uneq_cell(const ss_t current_ptr, const ss_t end_ptr,int *const row,i
     {
         for(*column=0; *column<GRID_SIZE; (*column)++)
         {
-            current_cell=current_ptr.cell[*row][*column];
-            end_cell=end_ptr.cell[*row][*column];
+            current_cell=current_ptr->cell[IDX(*row,*column)];
+            end_cell=end_ptr->cell[IDX(*row,*column)];
             if(current_cell!=end_cell)
 
                 break;
@@ -1255,8 +2297,8 @@ void first_uneq_cell(const ss_t current_ptr, const ss_t end_ptr,int *const row,i
             continue;
         }
 
-        current_cell=current_ptr.cell[*row][*column];
-        end_cell=end_ptr.cell[*row][*column];
+        current_cell=current_ptr->cell[IDX(*row,*column)];
+        end_cell=end_ptr->cell[IDX(*row,*column)];
         if(current_cell!=end_cell)
             break;
     }
@@ -1279,7 +2321,7 @@ bool is_repeated(ss_t *const root_ptr,ss_t *const end_ptr)
 
     for(; current_ptr<end_ptr; current_ptr++)
     {
-        if(sudoku_states_equal(*current_ptr,*end_ptr))
+        if(sudoku_states_equal(current_ptr,end_ptr))
         {
             ptrdiff_t diff=end_ptr-current_ptr;
             UNUSED(diff);
@@ -1293,47 +2335,37 @@ bool is_repeated(ss_t *const root_ptr,ss_t *const end_ptr)
 
 bool no_contradiction(ss_t *ss_ptr)
 {
-    assert(ss_ptr->hash >= 0);
-    assert(ss_ptr->hash <= GRID_SIZE * GRID_SIZE);
+    assert(ss_ptr->head.hash >= 0);
+    assert(ss_ptr->head.hash <= GRID_SIZE * GRID_SIZE);
     
-    if(ss_ptr->hash == GRID_SIZE * GRID_SIZE)
+    if(ss_ptr->head.hash == GRID_SIZE * GRID_SIZE)
         return true;
     return false;
 }
 
 void compute_contra(ss_t *ss_ptr)
 {
-    uint8_t row;
-    uint8_t column;
-    uint8_t row2;
-    uint8_t column2;
-    uint16_t cell_1;
-    uint16_t cell_2;
-    bool cell_1_isv;
-    bool cell_2_isv;
-
-    ss_ptr->contra = false;
-    for(row=0; row<GRID_SIZE; row++)
-        for(column=0; column<GRID_SIZE; column++)
-            for(row2=0; row2<GRID_SIZE; row2++)
-                for(column2=0; column2<GRID_SIZE; column2++)
-                {
-                    if(row==row2 && column==column2) // ignore same cell
-                        continue;
-                    bool related = row_column_region(row,column,row2,column2);
-                    cell_1=ss_ptr->cell[row][column];
-                    cell_2=ss_ptr->cell[row2][column2];
-                    cell_1_isv = is_single_value(cell_1);
-                    cell_2_isv=is_single_value(cell_2);
-                    if(related && cell_1==cell_2 && cell_1_isv && cell_2_isv)
-                    {
-                        ss_ptr->contra = true;
-                        return;
-                    }
-                }
+    ss_ptr->head.contra = find_contra(ss_ptr);
     return;
 }
 
+bool find_contra(ss_t const *const ss_ptr)
+{
+    int i;
+    int j;
+
+    for(i=0; i<N_CELLS; i++)
+    {
+        uint16_t const cell_1=ss_ptr->cell[i];
+        if(!is_single_value(cell_1))
+            continue;
+        for(j=0; j<PEERS; j++)
+            if(ss_ptr->cell[peers[i][j]]==cell_1)
+                return true;
+    }
+    return false;
+}
+
 noreturn void print_finish(char const * const input, char const * const output, int count, time_t begin)
 {
     time_t end;
@@ -1342,6 +2374,8 @@ noreturn void print_finish(char const * const input, char const * const output,
     printf("Output file name is %s\n",output);
     printf("Count of solved sudokus is %d\n", count);
     printf("Average time on solving each puzzle is %lf sec\n", difftime(end, begin)/count);
+    if(out_file!=NULL && fclose(out_file)!=0)
+        fatal_err("Writing output file %s failed.", output);
     exit (EXIT_SUCCESS);
 }
 
@@ -1379,3 +2413,71 @@ void print_cell_callee(const char* const cell_name, uint16_t cell)
 }
 
 // @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ //
+
+#ifdef TEST
+void run_tests(void)
+{
+    if(CU_initialize_registry()!=CUE_SUCCESS)
+        fatal_err("Initialization failed.");
+
+    CU_pSuite suite1 = CU_add_suite("sudoku_test_suite", NULL, NULL);
+    if(suite1 == NULL)
+        fatal_err("suite1 creation failed.");
+
+    if(CU_add_test(suite1, "test_restart_limit", test_restart_limit) == NULL)
+        fatal_err("test_restart_limit creation failed.");
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+}
+
+void test_restart_limit(void) // limits past nmax are cut, so restarted searches end
+{
+    char const *const grid= // third puzzle of sudoku_input.text, runs reach nmax 40 without the cut
+        "*2*******" "***6****3" "*74*8****" "*****3**2" "*8**4**1*"
+        "6**5*****" "****1*78*" "5****9***" "*******4*";
+    struct restart_info const saved=restart;
+    unsigned const nmax=40;
+    ss_t ss;
+    int cell;
+    unsigned seed;
+
+    restart.max_limit=nmax-1;
+    restart.policy=RESTART_LUBY;
+    CU_ASSERT(restart_limit(1)==RESTART_UNIT);
+    CU_ASSERT(restart_limit(3)==nmax-1); // 32*luby(3) is 64
+    CU_ASSERT(restart_limit(63)==nmax-1);
+    restart.policy=RESTART_GEOMETRIC;
+    CU_ASSERT(restart_limit(1)==RESTART_UNIT);
+    CU_ASSERT(restart_limit(2)==nmax-1); // 32*1.5 is 48
+    CU_ASSERT(restart_limit(1000)==nmax-1);
+    restart.max_limit=N_MAX-1;
+    CU_ASSERT(restart_limit(10)==N_MAX-1); // 32*1.5^9 is about 1230
+    restart.policy=RESTART_LUBY;
+    CU_ASSERT(restart_limit(63)==N_MAX-1); // 32*32 is 1024
+    restart.limit=restart_limit(63);
+    CU_ASSERT(restart_due(N_MAX)); // before fill_cells checks n against nmax
+
+    out_file=tmpfile();
+    CU_ASSERT_PTR_NOT_NULL(out_file);
+    if(out_file==NULL)
+        return;
+    restart.max_limit=nmax-1;
+    for(seed=1; seed<=8; seed++) // solve_one ends the program when n reaches nmax
+    {
+        restart.policy=(seed%2 ? RESTART_LUBY : RESTART_GEOMETRIC);
+        srand(seed);
+        memset(&ss, 0, sizeof(ss));
+        for(cell=0; cell<N_CELLS; cell++)
+            ss.cell[cell]=(uint16_t)(grid[cell]=='*' ? nine_possible() : 1<<(grid[cell]-'1'));
+        compute_hash(&ss);
+        solve_one(&ss, "test output", nmax);
+        CU_ASSERT(ftell(out_file)>0);
+    }
+
+    fclose(out_file);
+    out_file=NULL;
+    restart=saved;
+}
+#endif // TEST